@@ -166,6 +166,10 @@ void AlarmManager::begin() {
 }
 
 void AlarmManager::update() {
+  for (int i = 0; i < NUM_ALARMS; i++) {
+    trigger_count_ += alarms_[i].isON() && !was_on_[i];
+    was_on_[i] = alarms_[i].isON();
+  }
   displ_->setAlarmText(getText());
   AlarmLevel highest_level = getHighestLevel();
   beeper_.update(highest_level);
@@ -196,7 +200,7 @@ String AlarmManager::getText() const {
   String text = "";
   if (num_on > 0) {
     // determine which of the on alarms to display
-    const int index = millis() % (num_on * kDisplayTime) / kDisplayTime;
+    const int index = rotation_.cycles() % num_on;
     int count_on = 0;
     int i;
     for (i = 0; i < NUM_ALARMS; i++) {
@@ -222,6 +222,13 @@ class AlarmManager {
     NO_TIDAL_PR,
     OVER_CURREN,
     MECH_FAILUR,
+    LOW_MIN_VEN,
+    APNEA_ALRM,
+    DOUBLE_TRIG,
+    AUTO_TRIGGR,
+    LOW_VOLTAGE,
+    DRIVER_TEMP,
+    DRIVER_ERR,
     NOT_CONFIRM,
     TURNING_OFF,
     NUM_ALARMS 
@@ -234,6 +241,7 @@ public:
       beeper_(beeper_pin, snooze_pin),
       led_pin_(led_pin),
       led_pulse_(500, 0.5),
+      rotation_(kDisplayTime, 1.0, false),
       cycle_count_(cycle_count) {
     alarms_[HIGH_PRESSU] = Alarm("   HIGH PRESSURE    ", 1, 2, EMERGENCY);
     alarms_[LOW_PRESSUR] = Alarm("LOW PRES DISCONNECT?", 1, 1, EMERGENCY);
@@ -242,6 +250,13 @@ public:
     alarms_[NO_TIDAL_PR] = Alarm(" NO TIDAL PRESSURE  ", 2, 1, EMERGENCY);
     alarms_[OVER_CURREN] = Alarm(" OVER CURRENT FAULT ", 1, 2, EMERGENCY);
     alarms_[MECH_FAILUR] = Alarm(" MECHANICAL FAILURE ", 1, 1, EMERGENCY);
+    alarms_[LOW_MIN_VEN] = Alarm(" LOW MINUTE VOLUME  ", 1, 1, NOTIFY);
+    alarms_[APNEA_ALRM]  = Alarm("       APNEA        ", 1, 1, NOTIFY);
+    alarms_[DOUBLE_TRIG] = Alarm(" DOUBLE TRIGGERING  ", 1, 3, NOTIFY);
+    alarms_[AUTO_TRIGGR] = Alarm("  AUTO TRIGGERING   ", 2, 3, NOTIFY);
+    alarms_[LOW_VOLTAGE] = Alarm(" LOW SUPPLY VOLTAGE ", 1, 1, EMERGENCY);
+    alarms_[DRIVER_TEMP] = Alarm(" DRIVER OVERHEATING ", 1, 1, NOTIFY);
+    alarms_[DRIVER_ERR]  = Alarm(" MOTOR DRIVER ERROR ", 1, 1, EMERGENCY);
     alarms_[NOT_CONFIRM] = Alarm("      CONFIRM?      ", 1, 1, NOTIFY);
     alarms_[TURNING_OFF] = Alarm("    TURNING OFF     ", 1, 1, OFF_LEVEL);
   }
@@ -290,6 +305,41 @@ public:
     alarms_[MECH_FAILUR].setCondition(value, *cycle_count_);
   }
 
+  // Measured minute ventilation too low
+  inline void lowMinuteVentilation(const bool& value) {
+    alarms_[LOW_MIN_VEN].setCondition(value, *cycle_count_);
+  }
+
+  // No patient effort for the apnea time in assist control
+  inline void apnea(const bool& value) {
+    alarms_[APNEA_ALRM].setCondition(value, *cycle_count_);
+  }
+
+  // Patient effort during the refractory window of a triggered breath
+  inline void doubleTrigger(const bool& value) {
+    alarms_[DOUBLE_TRIG].setCondition(value, *cycle_count_);
+  }
+
+  // Breath triggered without a sustained patient effort
+  inline void autoTrigger(const bool& value) {
+    alarms_[AUTO_TRIGGR].setCondition(value, *cycle_count_);
+  }
+
+  // Motor supply voltage too low
+  inline void lowSupplyVoltage(const bool& value) {
+    alarms_[LOW_VOLTAGE].setCondition(value, *cycle_count_);
+  }
+
+  // Motor driver temperature too high
+  inline void driverOverheat(const bool& value) {
+    alarms_[DRIVER_TEMP].setCondition(value, *cycle_count_);
+  }
+
+  // Motor driver reporting an error
+  inline void driverError(const bool& value) {
+    alarms_[DRIVER_ERR].setCondition(value, *cycle_count_);
+  }
+
   // Setting not confirmed
   inline void unconfirmedChange(const bool& value, const String& message = "") {
     if (value) {
@@ -302,6 +352,13 @@ public:
     alarms_[TURNING_OFF].setCondition(value, *cycle_count_);
   }
 
+  // Get number of alarms that are ON
+  int numON() const;
+
+  // Number of times any alarm turned ON, e.g. restored after a reset
+  inline const unsigned long& triggerCount() const { return trigger_count_; }
+  inline void setTriggerCount(const unsigned long& count) { trigger_count_ = count; }
+
   // Get current state of each alarm
   inline const bool& getHighPressure()      { return alarms_[HIGH_PRESSU].isON(); }
   inline const bool& getLowPressure()       { return alarms_[LOW_PRESSUR].isON(); }
@@ -310,6 +367,13 @@ public:
   inline const bool& getNoTidalPres()       { return alarms_[NO_TIDAL_PR].isON(); }
   inline const bool& getOverCurrent()       { return alarms_[OVER_CURREN].isON(); }
   inline const bool& getMechanicalFailure() { return alarms_[MECH_FAILUR].isON(); }
+  inline const bool& getLowMinuteVentilation() { return alarms_[LOW_MIN_VEN].isON(); }
+  inline const bool& getApnea()             { return alarms_[APNEA_ALRM].isON(); }
+  inline const bool& getDoubleTrigger()     { return alarms_[DOUBLE_TRIG].isON(); }
+  inline const bool& getAutoTrigger()       { return alarms_[AUTO_TRIGGR].isON(); }
+  inline const bool& getLowSupplyVoltage() { return alarms_[LOW_VOLTAGE].isON(); }
+  inline const bool& getDriverOverheat()    { return alarms_[DRIVER_TEMP].isON(); }
+  inline const bool& getDriverError()       { return alarms_[DRIVER_ERR].isON(); }
   inline const bool& getUnconfirmedChange() { return alarms_[NOT_CONFIRM].isON(); }
   inline const bool& getTurningOFF()        { return alarms_[TURNING_OFF].isON(); }
 
@@ -318,11 +382,11 @@ private:
   Beeper beeper_;
   int led_pin_;
   utils::Pulse led_pulse_;
+  utils::Pulse rotation_;  // Counts kDisplayTime periods to rotate the alarm shown
   Alarm alarms_[NUM_ALARMS];
   unsigned long const* cycle_count_;
-
-  // Get number of alarms that are ON
-  int numON() const;
+  unsigned long trigger_count_ = 0;
+  bool was_on_[NUM_ALARMS] = {};
 
   // Get text to display
   String getText() const;
@@ -0,0 +1,101 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Calibration.cpp
+ */
+
+#include "Calibration.h"
+
+#include "Pressure.h"
+
+
+namespace calibration {
+
+
+int16_t zero_q4 = Pressure::kNominalZero * 16 + 0.5;
+
+
+/// ZeroTracker ///
+
+void ZeroTracker::capture() {
+  capturing_ = true;
+  reset();
+}
+
+void ZeroTracker::update(const bool& atmospheric) {
+  // Skip the samples taken outside of atmospheric windows
+  const uint8_t head = sampler_->head();
+  if (!atmospheric) {
+    tail_ = head;
+    reset();
+    return;
+  }
+
+  // Consume the samples taken since the last update, a gap breaks the window
+  if ((uint8_t)(head - tail_) >= sampling::AdcSampler::kBufferSize) {
+    tail_ = head;
+    reset();
+    return;
+  }
+  while (tail_ != head) {
+    const uint16_t raw = sampler_->at(tail_++);
+    sum_ += raw;
+    min_ = min(min_, raw);
+    max_ = max(max_, raw);
+    count_++;
+  }
+  if (count_ < kWindowSamples) {
+    return;
+  }
+
+  const int16_t nominal = Pressure::kNominalZero * 16 + 0.5;
+  const int16_t mean_q4 = (16 * sum_ + count_ / 2) / count_;
+  if (max_ - min_ <= kMaxSpread && abs(mean_q4 - nominal) <= kMaxOffset) {
+    if (capturing_) {
+      zero_q4 = mean_q4;
+      capturing_ = false;
+    }
+    else {
+      zero_q4 += (mean_q4 - zero_q4) / (1 << kDriftShift);
+    }
+  }
+  reset();
+}
+
+float ZeroTracker::offset() const {
+  return (zero_q4 - Pressure::kNominalZero * 16) / 16 * Pressure::kCmH2OPerCount;
+}
+
+void ZeroTracker::reset() {
+  sum_ = 0;
+  count_ = 0;
+  min_ = 0xFFFF;
+  max_ = 0;
+}
+
+
+}  // namespace calibration
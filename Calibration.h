@@ -0,0 +1,102 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Calibration.h
+ * Pressure sensor zero, captured at startup and tracked while the airway is at
+ * atmospheric pressure.
+ */
+
+#ifndef Calibration_h
+#define Calibration_h
+
+#include "Arduino.h"
+
+#include "Sampling.h"
+
+
+namespace calibration {
+
+
+// Raw pressure reading at atmospheric pressure, in 1/16 ADC counts. Read by the
+// pressure conversions, so a new zero costs nothing per sample.
+extern int16_t zero_q4;
+
+
+/**
+ * ZeroTracker
+ * Averages the raw pressure samples over windows of kWindowSamples while told the
+ * airway is at atmospheric pressure, discarding windows that are not flat. The
+ * first accepted window after `capture()` sets the zero, later ones move it by a
+ * fraction towards their mean, so only slow drift is followed.
+ */
+class ZeroTracker {
+public:
+  // Samples averaged per window, about 0.5 s
+  static const uint16_t kWindowSamples = 256;
+
+  // Spread (ADC counts) above which a window is not at rest, about 1 cmH2O
+  static const uint8_t kMaxSpread = 4;
+
+  // Furthest the zero may be from nominal (1/16 counts), about 10 cmH2O
+  static const int16_t kMaxOffset = 40 * 16;
+
+  // Each accepted window moves the zero by 1/2^kDriftShift of the difference
+  static const uint8_t kDriftShift = 3;
+
+  explicit ZeroTracker(const sampling::AdcSampler* sampler): sampler_(sampler) {}
+
+  // Set the zero from the next accepted window instead of tracking drift
+  void capture();
+
+  // Update during arduino loop(), with whether the airway is at atmospheric pressure
+  void update(const bool& atmospheric);
+
+  // Check if a zero was set since the last `capture()`
+  inline bool captured() const { return !capturing_; }
+
+  // Offset (cmH2O) of the zero from that of an ideal sensor
+  float offset() const;
+
+private:
+  const sampling::AdcSampler* sampler_;
+  uint8_t tail_ = 0;
+  bool capturing_ = false;
+
+  uint32_t sum_ = 0;
+  uint16_t count_ = 0;
+  uint16_t min_ = 0xFFFF;
+  uint16_t max_ = 0;
+
+  // Start a new window
+  void reset();
+};
+
+
+}  // namespace calibration
+
+
+#endif
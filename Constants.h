@@ -42,7 +42,8 @@ enum States {
   HOLD_EX_STATE,     // 5
   PREHOME_STATE,     // 6
   HOMING_STATE,      // 7
-  OFF_STATE          // 8
+  OFF_STATE,         // 8
+  NUM_STATES
 };
 
 // Serial baud rate
@@ -51,12 +52,56 @@ const long SERIAL_BAUD_RATE = 115200;
 // Flags
 const bool DEBUG = false; // For controlling and displaying via serial
 const bool ASSIST_CONTROL = false; // Enable assist control
+const bool PRESSURE_CONTROL = false; // Track a pressure during inspiration instead of delivering a volume
+const bool PRESSURE_GRAPH = true; // Show a pressure bar graph instead of the "Pressure:" label
+
+// Configuration profiles: knob ranges, breath timing and pressure limit per patient
+// group. Every combination of knob settings is checked at compile time against the
+// timing and motion limits, see ValidateConfig at the end of this file.
+struct AdultProfile {
+  static constexpr int BPM_MIN = 10;
+  static constexpr int BPM_MAX = 35;
+  static constexpr int BPM_RES = 1;
+  static constexpr float IE_MIN = 1;
+  static constexpr float IE_MAX = 2.5;
+  static constexpr float IE_RES = 0.1;
+  static constexpr int VOL_MIN = 100;
+  static constexpr int VOL_MAX = 800;
+  static constexpr int VOL_RES = 25;
+  static constexpr float HOLD_IN_DURATION = 0.1;
+  static constexpr float MIN_PEEP_PAUSE = 0.05;
+  static constexpr float MAX_EX_DURATION = 1.00;
+  static constexpr float MAX_PRESSURE = 40.0;
+};
+
+struct PediatricProfile {
+  static constexpr int BPM_MIN = 15;
+  static constexpr int BPM_MAX = 50;
+  static constexpr int BPM_RES = 1;
+  static constexpr float IE_MIN = 1;
+  static constexpr float IE_MAX = 3;
+  static constexpr float IE_RES = 0.1;
+  static constexpr int VOL_MIN = 50;
+  static constexpr int VOL_MAX = 300;
+  static constexpr int VOL_RES = 10;
+  static constexpr float HOLD_IN_DURATION = 0.05;
+  static constexpr float MIN_PEEP_PAUSE = 0.05;
+  static constexpr float MAX_EX_DURATION = 0.75;
+  static constexpr float MAX_PRESSURE = 30.0;
+};
+
+typedef AdultProfile Config;  // The active profile
 
 // Timing Settings
-const float LOOP_PERIOD = 0.03;       // The period (s) of the control loop
-const float HOLD_IN_DURATION = 0.1;  // Duration (s) to pause after inhalation
-const float MIN_PEEP_PAUSE = 0.05;    // Time (s) to pause after exhalation / before watching for an assisted inhalation
-const float MAX_EX_DURATION = 1.00;   // Maximum exhale duration (s)
+constexpr float LOOP_PERIOD = 0.03;       // The period (s) of the control loop
+const float HOLD_IN_DURATION = Config::HOLD_IN_DURATION;  // Duration (s) to pause after inhalation
+const float MIN_PEEP_PAUSE = Config::MIN_PEEP_PAUSE;  // Time (s) to pause after exhalation / before watching for an assisted inhalation
+const float MAX_EX_DURATION = Config::MAX_EX_DURATION;  // Maximum exhale duration (s)
+
+// Pressure Control Settings
+const float PC_PRESSURE = 20.0;  // Target inspiratory pressure (cmH2O), the volume knob sets the volume limit
+const float PC_KP = 60.0;        // Pressure loop proportional gain, clicks/s per cmH2O
+const float PC_KI = 300.0;       // Pressure loop integral gain, clicks/s per cmH2O*s
 
 // Homing Settings
 const float HOMING_VOLTS = 30;  // The speed (0-255) in volts to use during homing
@@ -64,6 +109,9 @@ const float HOMING_PAUSE = 1.0; // The pause time (s) during homing to ensure st
 const int BAG_CLEAR_POS = 50;   // The goal position (clicks) to retract to clear the bag
 const int BAG_CLEAR_TOL = 10;   // The tolerance (clicks) to consider clear of bag
 
+// Storage Settings
+const unsigned long BREATH_SAVE_INTERVAL = 20;  // Breaths between saves of the total breath count
+
 // Pins
 const int VOL_PIN = A0;
 const int BPM_PIN = A1;
@@ -85,32 +133,37 @@ const int LCD_D6_PIN = 5;
 const int LCD_D7_PIN = 4;
 
 // Control knob mappings
-const int BPM_MIN = 10;
-const int BPM_MAX = 35;
-const int BPM_RES = 1;
-const float IE_MIN = 1;
-const float IE_MAX = 4;
-const float IE_RES = 0.1;
-const int VOL_MIN = 100;
-const int VOL_MAX = 800; 
-const int VOL_RES = 25; 
+const int BPM_MIN = Config::BPM_MIN;
+const int BPM_MAX = Config::BPM_MAX;
+const int BPM_RES = Config::BPM_RES;
+const float IE_MIN = Config::IE_MIN;
+const float IE_MAX = Config::IE_MAX;
+const float IE_RES = Config::IE_RES;
+const int VOL_MIN = Config::VOL_MIN;
+const int VOL_MAX = Config::VOL_MAX;
+const int VOL_RES = Config::VOL_RES;
 const float AC_MIN = 2;
 const float AC_MAX = 5;
 const float AC_RES = 0.1;
 const int ANALOG_PIN_MAX = 1023; // The maximum count on analog pins
 
 // Bag Calibration for AMBU Adult bag
-const struct {float a, b, c;} COEFFS{1.29083271e-03, 4.72985182e-01, -7.35403067e+01};
+constexpr struct {float a, b, c;} COEFFS{1.29083271e-03, 4.72985182e-01, -7.35403067e+01};
 
 // Safety settings
-const float MAX_PRESSURE = 40.0;        // Trigger high pressure alarm
+const float MAX_PRESSURE = Config::MAX_PRESSURE;  // Trigger high pressure alarm
 const float MIN_PLATEAU_PRESSURE = 5.0; // Trigger low pressure alarm
 const float MAX_RESIST_PRESSURE = 2.0;  // Trigger high-resistance notification
+const float MAX_RESISTANCE = 30.0;      // Trigger high-resistance notification once estimated, cmH2O/(L/s)
 const float MIN_TIDAL_PRESSURE = 5.0;   // Trigger no-tidal-pressure alarm
 const float VOLUME_ERROR_THRESH = 50.0; // Trigger incomplete breath alarm
+const float MIN_VENTILATION_FRACTION = 0.5; // Trigger low minute ventilation alarm below this fraction of the set one
 const int MAX_MOTOR_CURRENT = 1000;     // Trigger mechanical failure alarm. Units (10mA)
 const float TURNING_OFF_DURATION = 5.0; // Turning-off alarm is on for this duration (s)
+const float APNEA_TIME = 20.0;          // Trigger apnea alarm after this time (s) without patient effort in assist control
 const float MECHANICAL_TIMEOUT = 1.0;   // Time to wait for the mechanical cycle to finish before alarming
+const float MIN_SUPPLY_VOLTAGE = 11.0;  // Trigger low supply voltage alarm (V)
+const float MAX_DRIVER_TEMP = 80.0;     // Trigger driver overheating alarm (C)
 
 // PID values for auto-tuned for PG188
 const unsigned long QPPS = 2000;
@@ -123,13 +176,72 @@ const float PKD = 200.0;
 const unsigned long KI_MAX = 10;
 const unsigned long DEADZONE = 0;
 const unsigned long MIN_POS = -100;
-const unsigned long MAX_POS = 700;
-const unsigned long VEL_MAX = 1800;     // Maximum velocity (clicks/s) to command
-const unsigned long ACC_MAX = 200000;   // Maximum acceleration (clicks/s^2) to command
+constexpr unsigned long MAX_POS = 700;
+constexpr unsigned long VEL_MAX = 1800;     // Maximum velocity (clicks/s) to command
+constexpr unsigned long ACC_MAX = 200000;   // Maximum acceleration (clicks/s^2) to command
+
+// Position PID auto-tuning, with the bag removed
+const long TUNE_POS = 300;              // Center (clicks) of the relay test
+const long TUNE_SPAN = 200;             // Abort if further (clicks) from the center
+const int16_t TUNE_DUTY = 6000;         // Relay duty (0-32767)
+const float TUNE_GAIN_RANGE = 10.0;     // Reject tuned gains more than this factor off the constants above
 
 // Roboclaw
 const unsigned int ROBOCLAW_ADDR = 0x80;
 const long ROBOCLAW_BAUD = 38400;
 const unsigned long ROBOCLAW_MAX_CURRENT = 2000;    //Safety shutoff in units of 10mA
+const unsigned long ROBOCLAW_ERROR_MASK = 0xFFFF;   // Status flags that are errors, the rest are warnings
+
+// Compile-time checks of a configuration profile C at the corners of its knob ranges
+template <typename C>
+struct ValidateConfig {
+  // Bag volume (mL) at a motor position (clicks), as utils::ticks2volume
+  static constexpr float bagVolume(const float ticks) {
+    return COEFFS.a * ticks * ticks + COEFFS.b * ticks + COEFFS.c;
+  }
+
+  // Distance (clicks) spent ramping up to VEL_MAX and back down under ACC_MAX
+  static constexpr float kRampDistance = (float)VEL_MAX * VEL_MAX / ACC_MAX;
+
+  // Travel (clicks) of a move from rest to rest in a duration (s) under VEL_MAX and ACC_MAX,
+  // a trapezoid if there is time to reach VEL_MAX and a triangle otherwise
+  static constexpr float travel(const float dur) {
+    return dur >= 2.0 * VEL_MAX / ACC_MAX ? VEL_MAX * dur - kRampDistance : ACC_MAX * dur * dur / 4;
+  }
+
+  // Furthest position (clicks) reachable from BAG_CLEAR_POS in a duration (s),
+  // capped at MAX_POS since no move goes past it
+  static constexpr float reachable(const float dur) {
+    return BAG_CLEAR_POS + travel(dur) < MAX_POS ? BAG_CLEAR_POS + travel(dur) : MAX_POS;
+  }
+
+  // Shortest inhalation move (s), at BPM_MAX and IE_MAX
+  static constexpr float kMinInhale = 60.0 / C::BPM_MAX / (1 + C::IE_MAX) - C::HOLD_IN_DURATION;
+
+  // Shortest exhalation move (s), at BPM_MAX and IE_MIN or capped by MAX_EX_DURATION
+  static constexpr float kMinExhale =
+      60.0 / C::BPM_MAX * C::IE_MIN / (1 + C::IE_MIN) - C::MIN_PEEP_PAUSE < C::MAX_EX_DURATION ?
+      60.0 / C::BPM_MAX * C::IE_MIN / (1 + C::IE_MIN) - C::MIN_PEEP_PAUSE : C::MAX_EX_DURATION;
+
+  static_assert(C::BPM_MIN > 0 && C::BPM_MIN < C::BPM_MAX, "Bad BPM range");
+  static_assert(C::IE_MIN >= 1 && C::IE_MIN < C::IE_MAX, "Bad I:E range");
+  static_assert(C::VOL_MIN > 0 && C::VOL_MIN < C::VOL_MAX, "Bad volume range");
+  static_assert(C::HOLD_IN_DURATION >= LOOP_PERIOD, "Inspiratory hold shorter than a loop");
+  static_assert(C::MIN_PEEP_PAUSE >= LOOP_PERIOD, "PEEP pause shorter than a loop");
+  static_assert(kMinInhale >= 2 * LOOP_PERIOD,
+                "Inhalation too short at BPM_MAX and IE_MAX, lower them or HOLD_IN_DURATION");
+  static_assert(bagVolume(MAX_POS) >= C::VOL_MAX, "VOL_MAX beyond MAX_POS");
+  static_assert(bagVolume(reachable(kMinInhale)) >= C::VOL_MAX,
+                "VOL_MAX not reachable under VEL_MAX and ACC_MAX at BPM_MAX and IE_MAX");
+  static_assert(bagVolume(reachable(kMinExhale)) >= C::VOL_MAX,
+                "Bag not cleared under VEL_MAX and ACC_MAX in the shortest exhalation");
+  static_assert(bagVolume(BAG_CLEAR_POS + kRampDistance) <= C::VOL_MIN,
+                "ACC_MAX too low, the ramps to VEL_MAX alone are longer than a VOL_MIN stroke");
+
+  static constexpr bool valid = true;
+};
+
+static_assert(ValidateConfig<AdultProfile>::valid, "Invalid adult profile");
+static_assert(ValidateConfig<PediatricProfile>::valid, "Invalid pediatric profile");
 
 #endif
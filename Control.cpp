@@ -0,0 +1,98 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Control.cpp
+ */
+
+#include "Control.h"
+
+#include <util/atomic.h>
+
+#include "Constants.h"
+#include "Pressure.h"
+
+
+namespace control {
+
+
+/// PressureController ///
+
+void PressureController::start(const float& target, const long& limit) {
+  // Gains per raw count so the interrupt never converts to cmH2O
+  const float cmh2o_per_count = Pressure::toPressure(1) - Pressure::toPressure(0);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    kp_q8_ = round(kp_ * cmh2o_per_count * 256);
+    ki_q8_ = round(ki_ * cmh2o_per_count * 256 / kRate);
+    target_raw_ = Pressure::toRaw(target);
+    limit_ = limit;
+    integral_ = 0;
+    divider_ = 0;
+    send_divider_ = kSendDivider;
+    speed_ = -1;  // Force the first command out
+    active_ = true;
+  }
+}
+
+void PressureController::stop() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    active_ = false;
+    roboclaw_->CancelPacketFromISR(packet_);
+  }
+}
+
+void PressureController::update(const uint16_t& raw) {
+  if (!active_ || ++divider_ < kDivider) {
+    return;
+  }
+  divider_ = 0;
+
+  const int32_t error = (int32_t)target_raw_ - raw;
+  int32_t out = (kp_q8_ * error + ki_q8_ * integral_) >> 8;
+
+  // Only integrate while not saturated in the direction of the error
+  if ((out < max_speed_ || error < 0) && (out > 0 || error > 0)) {
+    integral_ += error;
+  }
+  out = constrain(out, 0, max_speed_);
+
+  if (send_divider_ < kSendDivider) {
+    ++send_divider_;
+  }
+  const bool changed = abs(out - speed_) >= kDeadband || (out == 0 && speed_ != 0);
+  if (changed && send_divider_ >= kSendDivider) {
+    send_divider_ = 0;
+    speed_ = out;
+    const uint8_t length = out > 0 ?
+        RoboClaw::EncodeSpeedAccelDeccelPositionM1(packet_, ROBOCLAW_ADDR, ACC_MAX, out,
+                                                   ACC_MAX, limit_, 1) :
+        RoboClaw::EncodeSpeedM1(packet_, ROBOCLAW_ADDR, 0);
+    roboclaw_->WritePacketFromISR(packet_, length);
+  }
+}
+
+
+}  // namespace control
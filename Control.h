@@ -0,0 +1,125 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Control.h
+ * Inner control loops that run in the sampling interrupt.
+ */
+
+#ifndef Control_h
+#define Control_h
+
+#include "Arduino.h"
+#include "src/thirdparty/RoboClaw/RoboClaw.h"
+
+#include "Sampling.h"
+
+
+namespace control {
+
+
+/**
+ * PressureController
+ * PI loop from the raw pressure samples to RoboClaw speed commands, used during
+ * inspiration in pressure control mode. Runs in the sampling interrupt in fixed
+ * point and sends its commands with `RoboClaw::WritePacketFromISR`, so it is not
+ * held back by the control loop period.
+ *
+ * Each speed is sent as a position command to the volume limit capped at that speed,
+ * so the RoboClaw itself stops the arm there even if the control loop misses it, e.g.
+ * on failed encoder reads. A speed of 0 is sent as a plain stop. The speed is only
+ * ever positive (pushing the bag), overshoot above the target is not relieved here
+ * but left to the OverpressureCutoff retract at MAX_PRESSURE.
+ *
+ * A command is only resent when the speed moves by more than kDeadband, or drops to
+ * 0, and at most every kSendDivider updates. A position packet and its ack take 22
+ * bytes, ~5.7ms at 38400 baud, so the loop uses at most ~18% of the link (one per
+ * 32ms).
+ */
+class PressureController {
+public:
+  // Inner loop rate (Hz)
+  static const unsigned long kRate = 250;
+
+  // Pressure samples per inner loop update
+  static const uint8_t kDivider = sampling::AdcSampler::kPressureRate / kRate;
+
+  // Inner loop updates per speed command at most
+  static const uint8_t kSendDivider = 8;
+
+  // Smallest speed change (clicks/s) worth a command
+  static const long kDeadband = 20;
+
+  // Gains in clicks/s per cmH2O and clicks/s per cmH2O*s, speed limit in clicks/s
+  PressureController(RoboClaw* roboclaw, const float& kp, const float& ki, const long& max_speed):
+      roboclaw_(roboclaw),
+      kp_(kp),
+      ki_(ki),
+      max_speed_(max_speed) {}
+
+  // Start tracking the target pressure (cmH2O), never pushing past the limit (clicks)
+  void start(const float& target, const long& limit);
+
+  // Stop tracking, and drop any command not sent yet. The motor keeps its last speed
+  // until the control loop sends a new command.
+  void stop();
+
+  // Run the loop on a raw pressure sample, only to be called from the sampling interrupt
+  void update(const uint16_t& raw);
+
+  // Check if the loop is running
+  inline bool active() const { return active_; }
+
+  // Last commanded speed (clicks/s)
+  inline long speed() const { return speed_; }
+
+private:
+  // Length of a SpeedAccelDeccelPositionM1 packet including CRC, the longest sent
+  static const uint8_t kPacketLength = 21;
+
+  RoboClaw* roboclaw_;
+  const float kp_, ki_;
+  const long max_speed_;
+
+  // Gains per raw count, Q8 fixed point
+  int32_t kp_q8_ = 0;
+  int32_t ki_q8_ = 0;
+  uint16_t target_raw_ = 0;
+  long limit_ = 0;
+
+  volatile bool active_ = false;
+  uint8_t divider_ = 0;
+  uint8_t send_divider_ = 0;
+  int32_t integral_ = 0;
+  volatile long speed_ = 0;
+  uint8_t packet_[kPacketLength];
+};
+
+
+}  // namespace control
+
+
+#endif
@@ -32,12 +32,27 @@
 
 namespace display {
 
+namespace {
+
+// Character code of the bar of height 1, the custom characters 0-7 repeat at 8-15
+const char kFirstBar = 8;
+
+}  // namespace
+
 
 /// Display ///
 
 void Display::begin() {
-  lcd_->begin(kWidth, kHeight);
-  lcd_->noCursor(); 
+  lcd_->begin(kWidth, kHeight);  // The cursor is off
+  if (pressure_graph_) {
+    // Custom character i is a bar with the bottom i + 1 rows on
+    uint8_t bar[8] = {0};
+    for (int i = 0; i < 8; i++) {
+      bar[7 - i] = 0x1F;
+      lcd_->createChar(i, bar);
+    }
+    graph_time_ = millis();
+  }
   update();
 }
 
@@ -114,17 +129,26 @@ void Display::writeHeader() {
 void Display::writeVolume(const int& vol) {
   const int vol_c = constrain(vol, 0, 999);
   char buff[12];
-  sprintf(buff, "%2s=%3s     ", getLabel(VOLUME).c_str(), toString(VOLUME, vol_c).c_str());
+  sprintf(buff, "%2s=%3s%s", getLabel(VOLUME).c_str(), toString(VOLUME, vol_c).c_str(),
+          measuredString(measured_vol_, 3).c_str());
   write(elements_[VOLUME].row, elements_[VOLUME].col, buff);
 }
 
 void Display::writeBPM(const int& bpm) {
   const int bpm_c = constrain(bpm, 0, 99);
   char buff[12];
-  sprintf(buff, "%2s=%2s      ", getLabel(BPM).c_str(), toString(BPM, bpm_c).c_str());
+  sprintf(buff, "%2s=%2s%s  ", getLabel(BPM).c_str(), toString(BPM, bpm_c).c_str(),
+          measuredString(measured_bpm_, 2).c_str());
   write(elements_[BPM].row, elements_[BPM].col, buff);
 }
 
+void Display::writeMeasured(const int& vol, const int& bpm) {
+  measured_vol_ = vol < 0 ? -1 : constrain(vol, 0, 999);
+  measured_bpm_ = bpm < 0 ? -1 : constrain(bpm, 0, 99);
+  write(elements_[VOLUME].row, elements_[VOLUME].col + 6, measuredString(measured_vol_, 3));
+  write(elements_[BPM].row, elements_[BPM].col + 5, measuredString(measured_bpm_, 2));
+}
+
 void Display::writeIEratio(const float& ie) {
   const float ie_c = constrain(ie, 0.0, 9.9);
   char buff[12];
@@ -144,7 +168,35 @@ void Display::writeACTrigger(const float& ac_trigger) {
 }
 
 void Display::writePresLabel() {
-  write(elements_[PRES_LABEL].row, elements_[PRES_LABEL].col, "Pressure:");
+  if (!pressure_graph_) {
+    write(elements_[PRES_LABEL].row, elements_[PRES_LABEL].col, "Pressure:");
+    return;
+  }
+  // Unchanged columns are skipped by the LCD, so this is cheap to call every loop
+  char buff[kGraphWidth + 1];
+  for (int i = 0; i < kGraphWidth; i++) {
+    const uint8_t level = graph_levels_[i];
+    buff[i] = (i == graph_index_ || level == 0) ? ' ' : kFirstBar + level - 1;
+  }
+  buff[kGraphWidth] = '\0';
+  write(elements_[PRES_LABEL].row, elements_[PRES_LABEL].col, buff);
+}
+
+void Display::addPressure(const float& pres) {
+  if (!pressure_graph_) {
+    return;
+  }
+  const int level = constrain(round(pres * 8 / kGraphFullScale), 0, 8);
+  if (level > graph_level_) {
+    graph_level_ = level;
+  }
+  if (millis() - graph_time_ < kGraphColumnPeriod) {
+    return;
+  }
+  graph_time_ += kGraphColumnPeriod;
+  graph_levels_[graph_index_] = graph_level_;
+  graph_index_ = (graph_index_ + 1) % kGraphWidth;
+  graph_level_ = 0;
 }
 
 void Display::writePeakP(const int& peak) {
@@ -192,6 +244,17 @@ String Display::toString(const DisplayKey& key, const T& value) const {
   }
 }
 
+String Display::measuredString(const int& value, const int& digits) const {
+  char buff[8];
+  if (value < 0) {
+    sprintf(buff, "%*s", digits + 2, "");
+  }
+  else {
+    sprintf(buff, "(%*d)", digits, value);
+  }
+  return buff;
+}
+
 template <typename T>
 void Display::write(const int& row, const int& col, const T& printable) {
   lcd_->setCursor(col, row);
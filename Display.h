@@ -33,8 +33,7 @@
 #define Display_h
 
 #include "Arduino.h"
-#include <LiquidCrystal.h>
-
+#include "Lcd.h"
 #include "Utilities.h"
 
 
@@ -95,10 +94,16 @@ enum DisplayKey {
  *    01234567890123456789    
  *    ____________________ 
  * 0 |AC=#.#     Pressure:|
- * 1 |TV=###       peak=##|
- * 2 |RR=##        plat=##|
+ * 1 |TV=###(###)  peak=##|
+ * 2 |RR=##(##)    plat=##|
  * 3 |IE=1:#.#     PEEP=##|
  *    ____________________ 
+ *
+ * Measured values are shown in parentheses next to the set values.
+ * With the pressure graph enabled, "Pressure:" is replaced by a sweeping bar
+ * graph of the highest pressure in each column period, drawn with the custom
+ * characters. Each new column overwrites the oldest one, with a blank gap in
+ * front of it, so only two characters change per column.
  */
 class Display {
 
@@ -117,17 +122,27 @@ class Display {
   };
 
 public:
+  // Number of columns of the pressure graph, the width of PRES_LABEL
+  static const int kGraphWidth = 9;
+
+  // Time (ms) covered by each column of the pressure graph
+  static const unsigned long kGraphColumnPeriod = 300;
+
+  // Pressure (cmH2O) of a full height bar
+  static constexpr float kGraphFullScale = 40.0;
+
   // Constructor, save a pointer to the (global) display object
-  Display(LiquidCrystal* lcd, const float& trigger_threshold):
+  Display(Lcd* lcd, const float& trigger_threshold, const bool& pressure_graph = false):
       lcd_(lcd),
       trigger_threshold_(trigger_threshold),
+      pressure_graph_(pressure_graph),
       animation_(1000, 0.5) {
     elements_[HEADER]       = Element{0, 0, 20};
     elements_[VOLUME]       = Element{1, 0, 11, "TV"};
     elements_[BPM]          = Element{2, 0, 11, "RR"};
     elements_[IE_RATIO]     = Element{3, 0, 11, "IE"};
     elements_[AC_TRIGGER]   = Element{0, 0, 11, "AC"};
-    elements_[PRES_LABEL]   = Element{0, 11, 9};
+    elements_[PRES_LABEL]   = Element{0, 11, kGraphWidth};
     elements_[PEAK_PRES]    = Element{1, 11, 9, "peak"};
     elements_[PLATEAU_PRES] = Element{2, 11, 9, "plat"};
     elements_[PEEP_PRES]    = Element{3, 11, 9, "PEEP"};
@@ -158,15 +173,21 @@ public:
   // Beats per minute
   void writeBPM(const int& bpm);
 
+  // Measured volume in mL and beats per minute, negative to blank them
+  void writeMeasured(const int& vol, const int& bpm);
+
   // Inhale/exhale ratio in format 1:ie
   void writeIEratio(const float& ie);
 
   // AC trigger pressure
   void writeACTrigger(const float& ac_trigger);
 
-  // Label for pressure units
+  // Label for pressure units, or the pressure graph if enabled
   void writePresLabel();
 
+  // Add the highest pressure since the last call to the pressure graph
+  void addPressure(const float& pres);
+
   // Peak pressure in cm of H2O
   void writePeakP(const int& peak);
 
@@ -184,10 +205,20 @@ public:
   inline String getLabel(const DisplayKey& key) const { return elements_[key].label; };
 
 private:
-  LiquidCrystal* lcd_;
+  Lcd* lcd_;
   const float trigger_threshold_;
+  const bool pressure_graph_;
   TextAnimation animation_;
   Element elements_[NUM_KEYS];
+  int measured_vol_ = -1;
+  int measured_bpm_ = -1;
+  uint8_t graph_levels_[kGraphWidth] = {0};  // Bar height (0-8) of each column of PRES_LABEL
+  uint8_t graph_index_ = 0;        // Next column to overwrite
+  uint8_t graph_level_ = 0;        // Highest bar height in the current column period
+  unsigned long graph_time_ = 0;   // Start of the current column period
+
+  // Format a measured value in parentheses, or blanks if negative
+  String measuredString(const int& value, const int& digits) const;
 
   // Write printable starting at (row, col)
   template <typename T>
@@ -137,6 +137,10 @@ public:
   // Update during arduino loop()
   void update();
 
+  // Set the confirmed value, e.g. restored after a reset. If the knob is not at
+  // that value, the change has to be confirmed as usual.
+  inline void restore(const T& value) { this->set_value_ = value; }
+
 private:
   buttons::DebouncedButton confirm_button_;
   AlarmManager* alarms_;
@@ -0,0 +1,231 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Lcd.cpp
+ */
+
+#include "Lcd.h"
+
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+
+namespace display {
+
+
+namespace {
+
+// HD44780 commands
+const uint8_t kClear = 0x01;
+const uint8_t kEntryMode = 0x06;     // Increment, no shift
+const uint8_t kDisplayOn = 0x0C;     // Display on, cursor and blink off
+const uint8_t kFunctionSet = 0x28;   // 4-bit bus, 2 lines, 5x8 font
+const uint8_t kSetAddress = 0x80;
+const uint8_t kSetCharAddress = 0x40;
+
+// DDRAM address of the start of each row
+const uint8_t kRowOffsets[Lcd::kMaxRows] = {0x00, 0x40, 0x14, 0x54};
+
+// The display written by the Timer3 interrupt
+Lcd* active_lcd = nullptr;
+
+}  // namespace
+
+
+/// Lcd ///
+
+Lcd::Lcd(const uint8_t& rs, const uint8_t& enable,
+         const uint8_t& d4, const uint8_t& d5, const uint8_t& d6, const uint8_t& d7):
+    pins_{rs, enable, d4, d5, d6, d7} {
+  memset(buffer_, ' ', sizeof(buffer_));
+}
+
+void Lcd::begin(const uint8_t& cols, const uint8_t& rows) {
+  cols_ = cols;
+  rows_ = rows;
+  if (cols_ > kMaxCols) cols_ = kMaxCols;
+  if (rows_ > kMaxRows) rows_ = kMaxRows;
+
+  Pin* pins[6] = {&rs_, &enable_, &data_[0], &data_[1], &data_[2], &data_[3]};
+  for (int i = 0; i < 6; i++) {
+    pinMode(pins_[i], OUTPUT);
+    pins[i]->port = portOutputRegister(digitalPinToPort(pins_[i]));
+    pins[i]->mask = digitalPinToBitMask(pins_[i]);
+  }
+
+  // Power-on sequence to enter 4-bit mode, from the HD44780 datasheet
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    TIMSK3 &= ~(1 << OCIE3A);
+  }
+  delay(50);
+  setPin(rs_, LOW);
+  setPin(enable_, LOW);
+  sendNibble(0x03);
+  delayMicroseconds(4500);
+  sendNibble(0x03);
+  delayMicroseconds(4500);
+  sendNibble(0x03);
+  delayMicroseconds(150);
+  sendNibble(0x02);
+  delayMicroseconds(100);
+  send(kFunctionSet, false);
+  delayMicroseconds(100);
+  send(kDisplayOn, false);
+  delayMicroseconds(100);
+  send(kClear, false);
+  delayMicroseconds(2000);
+  send(kEntryMode, false);
+  delayMicroseconds(100);
+  lcd_cursor_ = 0xFF;
+
+  // Timer3 in CTC mode at kTickRate, prescaler 8
+  active_lcd = this;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    TCCR3A = 0;
+    TCCR3B = (1 << WGM32) | (1 << CS31);
+    OCR3A = F_CPU / 8 / kTickRate - 1;
+    TCNT3 = 0;
+  }
+
+  // The LCD was cleared, resend whatever was printed before
+  for (uint8_t i = 0; i < cols_ * rows_; i++) {
+    if (buffer_[i] != ' ') {
+      dirty_[i / 8] |= 1 << (i % 8);
+    }
+  }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    TIMSK3 |= (1 << OCIE3A);
+  }
+}
+
+void Lcd::createChar(const uint8_t& location, const uint8_t charmap[]) {
+  // Keep the writer off the bus, its next tick sets the address back to the text
+  uint8_t timsk3;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    timsk3 = TIMSK3;
+    TIMSK3 &= ~(1 << OCIE3A);
+  }
+  send(kSetCharAddress | ((location & 0x07) << 3), false);
+  delayMicroseconds(40);
+  for (int i = 0; i < 8; i++) {
+    send(charmap[i], true);
+    delayMicroseconds(40);
+  }
+  lcd_cursor_ = 0xFF;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    TIMSK3 |= timsk3 & (1 << OCIE3A);
+  }
+}
+
+void Lcd::setCursor(const uint8_t& col, const uint8_t& row) {
+  cursor_ = (row < rows_ && col < cols_) ? row * kMaxCols + col : 0xFF;
+}
+
+size_t Lcd::write(uint8_t c) {
+  if (cursor_ == 0xFF) {
+    return 0;
+  }
+  if (buffer_[cursor_] != (char)c) {
+    buffer_[cursor_] = c;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      dirty_[cursor_ / 8] |= 1 << (cursor_ % 8);
+      TIMSK3 |= (1 << OCIE3A);
+    }
+  }
+  // Clip at the end of the row
+  cursor_ = (cursor_ % kMaxCols == cols_ - 1) ? 0xFF : cursor_ + 1;
+  return 1;
+}
+
+void Lcd::tick() {
+  uint8_t index;
+  if (!nextDirty(index)) {
+    TIMSK3 &= ~(1 << OCIE3A);  // Nothing to send, stop ticking until the next write
+    return;
+  }
+  if (index != lcd_cursor_) {
+    // Move the LCD cursor this tick, send the character the next one
+    send(kSetAddress | (kRowOffsets[index / kMaxCols] + index % kMaxCols), false);
+    lcd_cursor_ = index;
+    return;
+  }
+  dirty_[index / 8] &= ~(1 << (index % 8));
+  send(buffer_[index], true);
+  scan_ = index + 1;
+  // The address counter does not follow the rows past the end of one
+  lcd_cursor_ = (index % kMaxCols == cols_ - 1) ? 0xFF : index + 1;
+}
+
+bool Lcd::nextDirty(uint8_t& index) const {
+  const uint8_t size = sizeof(dirty_) * 8;
+  for (uint8_t n = 0; n < size; n++) {
+    const uint8_t i = (scan_ + n) % size;
+    if (i % 8 == 0 && dirty_[i / 8] == 0 && n + 8 <= size) {
+      n += 7;  // Skip a clean byte at once
+      continue;
+    }
+    if (dirty_[i / 8] & (1 << (i % 8))) {
+      index = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Lcd::send(const uint8_t& value, const bool& is_data) {
+  setPin(rs_, is_data);
+  sendNibble(value >> 4);
+  sendNibble(value & 0x0F);
+}
+
+void Lcd::sendNibble(const uint8_t& nibble) {
+  for (int i = 0; i < 4; i++) {
+    setPin(data_[i], nibble & (1 << i));
+  }
+  setPin(enable_, HIGH);
+  delayMicroseconds(1);  // Enable pulse of at least 450 ns
+  setPin(enable_, LOW);
+}
+
+void Lcd::setPin(const Pin& pin, const bool& high) {
+  if (high) {
+    *pin.port |= pin.mask;
+  }
+  else {
+    *pin.port &= ~pin.mask;
+  }
+}
+
+
+}  // namespace display
+
+
+ISR(TIMER3_COMPA_vect) {
+  if (display::active_lcd != nullptr) {
+    display::active_lcd->tick();
+  }
+}
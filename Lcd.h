@@ -0,0 +1,113 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Lcd.h
+ * HD44780 character LCD driver that writes to the display from a timer interrupt,
+ * so printing to it from the loop only updates RAM.
+ */
+
+#ifndef Lcd_h
+#define Lcd_h
+
+#include "Arduino.h"
+
+
+namespace display {
+
+
+/**
+ * Lcd
+ * Drop-in for the parts of `LiquidCrystal` used by `Display`, for a 4-bit bus with
+ * RW tied low. Printing writes into a frame buffer and marks the changed characters
+ * dirty. The Timer3 interrupt sends one byte per tick, either a character at the
+ * LCD cursor or a cursor move to the next dirty character, with direct port
+ * writes. Ticks are longer than the slowest command sent from the interrupt
+ * (37 us), so it never waits on the LCD. The interrupt only runs while characters
+ * are dirty. Only `begin()` blocks, for the power-on sequence.
+ */
+class Lcd : public Print {
+public:
+  // Largest supported display
+  static const uint8_t kMaxCols = 20;
+  static const uint8_t kMaxRows = 4;
+
+  // Bytes sent per second, a full 20x4 refresh takes about 40 ms
+  static const unsigned long kTickRate = 2000;
+
+  Lcd(const uint8_t& rs, const uint8_t& enable,
+      const uint8_t& d4, const uint8_t& d5, const uint8_t& d6, const uint8_t& d7);
+
+  // Initialize the LCD and start the writer, during arduino setup()
+  void begin(const uint8_t& cols, const uint8_t& rows);
+
+  // Define one of the 8 custom characters from 8 rows of 5 pixels, printed as
+  // character codes 8 to 15 so they can be part of strings. Blocks for ~0.5 ms.
+  void createChar(const uint8_t& location, const uint8_t charmap[]);
+
+  // Set where the next characters are printed
+  void setCursor(const uint8_t& col, const uint8_t& row);
+
+  // Print a character into the frame buffer, clipped at the end of the row
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+  // Send the next byte, only to be called from the timer interrupt
+  void tick();
+
+private:
+  // Output pin as port register and mask, so the interrupt needs no digitalWrite()
+  struct Pin {
+    volatile uint8_t* port;
+    uint8_t mask;
+  };
+
+  Pin rs_, enable_, data_[4];
+  uint8_t pins_[6];
+  uint8_t cols_ = kMaxCols;
+  uint8_t rows_ = kMaxRows;
+
+  char buffer_[kMaxRows * kMaxCols];
+  volatile uint8_t dirty_[(kMaxRows * kMaxCols + 7) / 8] = {};
+  uint8_t cursor_ = 0;  // Write position in the buffer
+  uint8_t lcd_cursor_ = 0xFF;  // Position of the LCD address counter, 0xFF if unknown
+  uint8_t scan_ = 0;  // Where the interrupt looks for dirty characters first
+
+  // Find the next dirty character from `scan_`, or return false
+  bool nextDirty(uint8_t& index) const;
+
+  // Send a byte to the LCD as two nibbles
+  void send(const uint8_t& value, const bool& is_data);
+  void sendNibble(const uint8_t& nibble);
+
+  static void setPin(const Pin& pin, const bool& high);
+};
+
+
+}  // namespace display
+
+
+#endif
@@ -116,9 +116,44 @@ Logger::Logger(bool log_to_serial, bool log_to_SD,
     delim_(delim) {}
 
 template <typename T>
-void Logger::addVar(const char var_name[], const T* var, 
-                    const int& min_digits, const int& float_precision) {
-  vars_[num_vars_++] = Var(var_name, var, min_digits, float_precision);
+bool Logger::addVar(const char var_name[], const T* var, 
+                    const int& min_digits, const int& float_precision,
+                    const bool& enabled) {
+  if (num_vars_ >= kMaxVars) {
+    return false;
+  }
+  vars_[num_vars_] = Var(var_name, var, min_digits, float_precision);
+  vars_[num_vars_++].enable(enabled);
+  return true;
+}
+
+bool Logger::enableVar(const String& label, const bool& enable) {
+  Var* var = findVar(label);
+  if (var == nullptr) {
+    return false;
+  }
+  header_changed_ |= var->enabled() != enable;
+  var->enable(enable);
+  return true;
+}
+
+bool Logger::setDecimation(const String& label, const uint8_t& decimation) {
+  Var* var = findVar(label);
+  if (var == nullptr) {
+    return false;
+  }
+  var->setDecimation(decimation);
+  return true;
+}
+
+bool Logger::printVar(Print& out, const uint8_t& index) const {
+  if (index >= num_vars_) {
+    return false;
+  }
+  out.print(vars_[index].label());
+  out.print(vars_[index].enabled() ? " on 1/" : " off 1/");
+  out.println(vars_[index].decimation());
+  return index + 1 < num_vars_;
 }
 
 void Logger::begin(const Stream* serial, const int& pin_select_SD) {
@@ -136,49 +171,69 @@ void Logger::begin(const Stream* serial, const int& pin_select_SD) {
 }
 
 void Logger::update() {
-  if ((!log_to_serial_ && !log_to_SD_) || num_vars_ == 0) {
+  const bool to_serial = log_to_serial_ && serial_on_;
+  const bool to_SD = log_to_SD_ && sd_on_;
+  if ((!to_serial && !to_SD) || num_vars_ == 0) {
     return;
   }
   unsigned long time_now = millis();
   String line, line_with_labels;
 
-  const bool need_line_without_labels = log_to_SD_ || (log_to_serial_ && !serial_labels_);
-  const bool need_line_with_labels = log_to_serial_ && serial_labels_;
+  const bool need_line_without_labels = to_SD || (to_serial && !serial_labels_);
+  const bool need_line_with_labels = to_serial && serial_labels_;
 
+  // Variables not due this update leave an empty field so columns stay aligned
+  bool first = true;
   for (int i = 0; i < num_vars_; i++) {
-    String word = vars_[i].serialize();
-    if (i != num_vars_ - 1) {
-      word += delim_;
+    if (!vars_[i].enabled()) {
+      continue;
     }
+    const bool due = updates_ % vars_[i].decimation() == 0;
+    const String word = due ? vars_[i].serialize() : "";
     if (need_line_without_labels) {
+      if (!first) line += delim_;
       line += word;
     }
-    if (need_line_with_labels) {
+    if (need_line_with_labels && due) {
+      if (line_with_labels.length() > 0) line_with_labels += delim_;
       line_with_labels += vars_[i].label() + ": " + word;
     }
+    first = false;
   }
-  
-  if (log_to_serial_) {
+  updates_++;
+
+  // Columns changed, print the labels again before the line
+  const String new_header = header_changed_ ? header() : "";
+
+  if (to_serial) {
+    if (header_changed_ && !serial_labels_) {
+      stream_->println(new_header);
+    }
     stream_->println(serial_labels_ ? line_with_labels : line);
   }
 
-  if (log_to_SD_) {
+  if (to_SD) {
     if (!file_) {
       file_ = SD.open(filename_, FILE_WRITE);
     }
     if (file_) {
-      file_.println(line);
+      if (header_changed_) {
+        file_size_ += file_.println(new_header);
+      }
+      file_size_ += file_.println(line);
     }
     if (time_now - last_save_ > kSavePeriod) {
       file_.close();
+      flushIndex();
       last_save_ = time_now;
     }
   }
+  header_changed_ = false;
 }
 
 void Logger::makeFile() {
   // Open file with number of last saved file
-  int num;
+  int num = 0;
   File number_file = SD.open("number.txt", FILE_READ);
   if (number_file) {
     num = number_file.parseInt();  
@@ -193,25 +248,129 @@ void Logger::makeFile() {
     number_file.close();
   }
 
-  // Assign the number to the new file name
+  // Assign the number to the new file names
   snprintf(filename_, sizeof(filename_), "DATA%03d.TXT", num);
+  snprintf(index_filename_, sizeof(index_filename_), "DATA%03d.IDX", num);
+  SD.remove(index_filename_);
   
   // Print the header
   file_ = SD.open(filename_, FILE_WRITE);
   if (file_) {
-    String line;
-    for (int i = 0; i < num_vars_; i++) {
-      line += vars_[i].label();
-      if (i != num_vars_ - 1) {
-        line += delim_;
-      }
-    }
-    file_.println(line);
+    file_size_ = file_.size();
+    file_size_ += file_.println(header());
     file_.close();
     last_save_ = millis();
   }
 }
 
+void Logger::markBreath(const unsigned long& breath) {
+  if (!log_to_SD_) {
+    return;
+  }
+  if (index_pending_ == kIndexBuffer) {
+    flushIndex();
+  }
+  index_buffer_[index_pending_++] = IndexEntry{breath, millis(), file_size_};
+}
+
+long Logger::findBreath(const unsigned long& breath) {
+  IndexEntry entry;
+  if (!searchIndex(breath, false, entry) || entry.breath != breath) {
+    return -1;
+  }
+  return entry.offset;
+}
+
+long Logger::findTime(const unsigned long& time) {
+  IndexEntry entry;
+  return searchIndex(time, true, entry) ? entry.offset : -1;
+}
+
+void Logger::printLine(Print& out, const unsigned long& offset) {
+  // Written lines may still be in the buffer of the open file
+  if (file_) {
+    file_.close();
+  }
+  File data = SD.open(filename_, FILE_READ);
+  if (!data || !data.seek(offset)) {
+    out.println("no such offset");
+    return;
+  }
+  int c;
+  while ((c = data.read()) >= 0 && c != '\n') {
+    out.print((char)c);
+  }
+  out.println();
+  data.close();
+}
+
+void Logger::flushIndex() {
+  if (index_pending_ == 0) {
+    return;
+  }
+  File index = SD.open(index_filename_, FILE_WRITE);
+  if (index) {
+    index.write((const uint8_t*)index_buffer_, index_pending_ * sizeof(IndexEntry));
+    index.close();
+  }
+  index_pending_ = 0;
+}
+
+bool Logger::searchIndex(const uint32_t& key, const bool& by_time, IndexEntry& entry) {
+  if (!log_to_SD_) {
+    return false;
+  }
+  flushIndex();
+  File index = SD.open(index_filename_, FILE_READ);
+  if (!index) {
+    return false;
+  }
+
+  // Lower bound over the entries, which increase in both breath and time
+  uint32_t lo = 0, hi = index.size() / sizeof(IndexEntry);
+  while (lo < hi) {
+    const uint32_t mid = (lo + hi) / 2;
+    index.seek(mid * sizeof(IndexEntry));
+    index.read(&entry, sizeof(IndexEntry));
+    if ((by_time ? entry.time : entry.breath) < key) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  const bool found = lo < index.size() / sizeof(IndexEntry);
+  if (found) {
+    index.seek(lo * sizeof(IndexEntry));
+    index.read(&entry, sizeof(IndexEntry));
+  }
+  index.close();
+  return found;
+}
+
+Var* Logger::findVar(const String& label) {
+  for (int i = 0; i < num_vars_; i++) {
+    if (vars_[i].label() == label) {
+      return &vars_[i];
+    }
+  }
+  return nullptr;
+}
+
+String Logger::header() const {
+  String line;
+  for (int i = 0; i < num_vars_; i++) {
+    if (!vars_[i].enabled()) {
+      continue;
+    }
+    if (line.length() > 0) {
+      line += delim_;
+    }
+    line += vars_[i].label();
+  }
+  return line;
+}
+
 
 }  // namespace logging
 
@@ -58,10 +58,24 @@ public:
   // Get a string representation of the variable pointed to
   String serialize() const;
 
+  // Enable or disable logging of the variable
+  inline void enable(const bool& enabled) { enabled_ = enabled; }
+
+  // Check if the variable is logged
+  inline const bool& enabled() const { return enabled_; }
+
+  // Log the variable once every `decimation` updates
+  inline void setDecimation(const uint8_t& decimation) { decimation_ = max(decimation, 1); }
+
+  // Get the number of updates per logged value
+  inline const uint8_t& decimation() const { return decimation_; }
+
 private:
   String label_;
   int min_digits_;
   int float_precision_;
+  bool enabled_ = true;
+  uint8_t decimation_ = 1;
 
   union {
     bool* b;
@@ -100,6 +114,11 @@ private:
 /**
  * Logger
  * Handles logging to serial or SD card.
+ *
+ * On SD, each boot writes a text log DATA###.TXT and an index DATA###.IDX of
+ * fixed-size binary entries (breath number, time in ms, offset in the log) in
+ * increasing order, one per `markBreath()`. A breath or a time is found in the
+ * log by binary search of the index.
  * 
  * Example usage:
  * 
@@ -112,7 +131,7 @@ private:
  *      logger.addVar("var1_label", &var1);
  *      logger.addVar("var2_label", &var2);
  *      ...
- *      logger.addVar("varN_label", &varN);
+ *      logger.addVar("varN_label", &varN, 1, 2, false);  // Registered but not logged
  *
  *      const int sd_select_pin = 53;
  *      logger.begin(&Serial, sd_select_pin);
@@ -133,17 +152,19 @@ class Logger {
   const unsigned long kSavePeriod = 1 * 1000UL;
 
   // Maximum number of variables to log
-  static const int kMaxVars = 20;
+  static const int kMaxVars = 24;
 
 public:
   // Set options
   Logger(bool log_to_serial, bool log_to_SD, 
          bool serial_labels = true, const String delim = "\t");
 
-  // Add variable
+  // Add variable, disabled ones can be enabled at runtime.
+  // Returns false if there are already kMaxVars.
   template <typename T>
-  void addVar(const char var_name[], const T* var, 
-              const int& min_digits = 1, const int& float_precision = 2);
+  bool addVar(const char var_name[], const T* var, 
+              const int& min_digits = 1, const int& float_precision = 2,
+              const bool& enabled = true);
 
   // Setup during arduino setup()
   // call after adding all the vars for the header to have them all
@@ -153,28 +174,90 @@ public:
   // Write all the variables to stream object and/or SD card
   void update();
 
+  // Index the current end of the SD log as the start of a breath
+  void markBreath(const unsigned long& breath);
+
+  // Find the SD log offset where a breath starts, -1 if it is not indexed
+  long findBreath(const unsigned long& breath);
+
+  // Find the SD log offset of the first breath at or after a time (ms), -1 if none
+  long findTime(const unsigned long& time);
+
+  // Print the line of the SD log starting at an offset
+  void printLine(Print& out, const unsigned long& offset);
+
+  // Enable or disable a variable by label, returns false if there is no such variable
+  bool enableVar(const String& label, const bool& enable);
+
+  // Log a variable once every `decimation` updates, returns false if there is no such variable
+  bool setDecimation(const String& label, const uint8_t& decimation);
+
+  // Print the label, state and decimation of a variable, returns false if it was
+  // the last one
+  bool printVar(Print& out, const uint8_t& index) const;
+
+  // Pause or resume logging to serial, if enabled in the constructor
+  inline void enableSerial(const bool& enable) { serial_on_ = enable; }
+
+  // Pause or resume logging to SD, if enabled in the constructor. Pausing closes the file.
+  inline void enableSD(const bool& enable) {
+    sd_on_ = enable;
+    if (!enable && file_) file_.close();
+  }
+
 private:
   // Options
   const bool log_to_serial_, log_to_SD_, serial_labels_;
   const String delim_;
+  bool serial_on_ = true;
+  bool sd_on_ = true;
+
+  // Index entry of a breath, stored as is in the index file
+  struct IndexEntry {
+    uint32_t breath;
+    uint32_t time;
+    uint32_t offset;
+  };
+
+  // Index entries kept in RAM until the next save
+  static const uint8_t kIndexBuffer = 4;
 
   // Stream objects
   Stream* stream_;
   char filename_[12] = "DATA000.TXT";
+  char index_filename_[12] = "DATA000.IDX";
   File file_;
+  uint32_t file_size_ = 0;
+  IndexEntry index_buffer_[kIndexBuffer];
+  uint8_t index_pending_ = 0;
 
   // Bookkeeping
   unsigned long last_save_ = 0;
   Var vars_[kMaxVars];
   int num_vars_ = 0;
+  unsigned long updates_ = 0;
+  bool header_changed_ = false;
 
   void makeFile();
+
+  // Append the buffered entries to the index file
+  void flushIndex();
+
+  // Find the first index entry with breath (or time) at or after `key`
+  bool searchIndex(const uint32_t& key, const bool& by_time, IndexEntry& entry);
+
+  // Get the variable with the given label, or nullptr
+  Var* findVar(const String& label);
+
+  // Labels of the enabled variables
+  String header() const;
 };
 
 // Instantiation of template methods
 #define INSTANTIATE_ADDVAR(vartype) \
-  template void Logger::addVar(const char var_name[], const vartype* var, \
-                               const int& min_digits, const int& float_precision);
+  template bool Logger::addVar(const char var_name[], const vartype* var, \
+                               const int& min_digits, const int& float_precision, \
+                               const bool& enabled);
 INSTANTIATE_ADDVAR(bool)
 INSTANTIATE_ADDVAR(int)
 INSTANTIATE_ADDVAR(float)
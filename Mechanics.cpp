@@ -0,0 +1,136 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Mechanics.cpp
+ */
+
+#include "Mechanics.h"
+
+
+namespace mechanics {
+
+
+namespace {
+
+// Determinant of the 3x3 matrix with columns c0, c1, c2
+float det3(const float c0[3], const float c1[3], const float c2[3]) {
+  return c0[0] * (c1[1] * c2[2] - c1[2] * c2[1])
+       - c1[0] * (c0[1] * c2[2] - c0[2] * c2[1])
+       + c2[0] * (c0[1] * c1[2] - c0[2] * c1[1]);
+}
+
+}  // namespace
+
+
+/// Estimator ///
+
+void Estimator::beginBreath(const float& volume, const float& time) {
+  breath_ = Sums{0, 0, 0, 0, 0, 0, 0, 0, 0};
+  volume0_ = volume;
+  last_volume_ = 0;
+  last_time_ = time;
+  in_breath_ = true;
+}
+
+void Estimator::addSample(const float& volume, const float& pressure, const float& time) {
+  const float dt = time - last_time_;
+  if (!in_breath_ || dt <= 0) {
+    return;
+  }
+  const float v_f = volume - volume0_;
+  const int32_t v = constrain(lround(v_f), -kMaxVolume, kMaxVolume);
+  const int32_t q = constrain(lround((v_f - last_volume_) / dt), -kMaxFlow, kMaxFlow);
+  const int32_t p = lround(pressure * 10);
+  last_volume_ = v_f;
+  last_time_ = time;
+
+  breath_.n++;
+  breath_.v += v;
+  breath_.q += q;
+  breath_.p += p;
+  breath_.vv += v * v;
+  breath_.qq += q * q;
+  breath_.vq += v * q;
+  breath_.vp += v * p;
+  breath_.qp += q * p;
+}
+
+void Estimator::endBreath() {
+  if (!in_breath_) {
+    return;
+  }
+  in_breath_ = false;
+  if (breath_.n < kMinSamples) {
+    return;
+  }
+
+  const int32_t sums[9] = {breath_.n, breath_.v, breath_.q, breath_.p, breath_.vv,
+                           breath_.qq, breath_.vq, breath_.vp, breath_.qp};
+  for (int i = 0; i < 9; i++) {
+    stats_[i] = kForgetting * stats_[i] + sums[i];
+  }
+  const float& n = stats_[0];
+  const float& sv = stats_[1];
+  const float& sq = stats_[2];
+  const float& sp = stats_[3];
+  const float& svv = stats_[4];
+  const float& sqq = stats_[5];
+  const float& svq = stats_[6];
+  const float& svp = stats_[7];
+  const float& sqp = stats_[8];
+
+  // Normal equations [svv svq sv; svq sqq sq; sv sq n] * [a b c]' = [svp sqp sp]'
+  const float c0[3] = {svv, svq, sv};
+  const float c1[3] = {svq, sqq, sq};
+  const float c2[3] = {sv, sq, n};
+  const float y[3] = {svp, sqp, sp};
+  const float d = det3(c0, c1, c2);
+  if (abs(d) < 1e-6 * svv * sqq * n) {
+    return;  // Not enough excitation to tell compliance and resistance apart
+  }
+  const float a = det3(y, c1, c2) / d;  // 0.1 cmH2O / mL
+  const float b = det3(c0, y, c2) / d;  // 0.1 cmH2O / (mL/s)
+  const float c = det3(c0, c1, y) / d;  // 0.1 cmH2O
+
+  if (a <= 0 || b < 0) {
+    valid_ = false;
+    return;
+  }
+  const float compliance = 10 / a;
+  const float resistance = b * 100;
+  valid_ = compliance > kMinCompliance && compliance < kMaxCompliance
+           && resistance < kMaxResistance;
+  if (valid_) {
+    compliance_ = compliance;
+    resistance_ = resistance;
+    time_constant_ = b / a;
+    peep_ = c / 10;
+  }
+}
+
+
+}  // namespace mechanics
@@ -0,0 +1,116 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Mechanics.h
+ * Estimates the respiratory mechanics (compliance, resistance and time constant)
+ * from the delivered volume and the airway pressure during inspiration.
+ */
+
+#ifndef Mechanics_h
+#define Mechanics_h
+
+#include "Arduino.h"
+
+
+namespace mechanics {
+
+
+/**
+ * Estimator
+ * Fits the single-compartment model P = V/C + R*Q + PEEP by least squares.
+ * Each sample only adds to integer sums of products (volume in mL, flow in mL/s,
+ * pressure in 0.1 cmH2O), so the per-sample cost is a handful of integer
+ * multiplications. At the end of each breath the sums are blended into the
+ * statistics of the previous breaths with a forgetting factor, which makes the
+ * estimate recursive across breaths, and the 3x3 normal equations are solved once.
+ */
+class Estimator {
+
+  // Weight of the previous breaths when adding a new one
+  static constexpr float kForgetting = 0.7;
+
+  // Minimum number of samples for a breath to be used
+  static const int kMinSamples = 8;
+
+  // Limits that keep the fixed-point sums from overflowing
+  static const int kMaxVolume = 2000;  // mL
+  static const int kMaxFlow = 3000;    // mL/s
+
+  // Plausible ranges, estimates outside are discarded
+  static constexpr float kMinCompliance = 1.0;    // mL/cmH2O
+  static constexpr float kMaxCompliance = 250.0;  // mL/cmH2O
+  static constexpr float kMaxResistance = 200.0;  // cmH2O/(L/s)
+
+public:
+  // Start a breath at the given delivered volume (mL) and time (s)
+  void beginBreath(const float& volume, const float& time);
+
+  // Add a sample of delivered volume (mL) and pressure (cmH2O) at the given time (s)
+  void addSample(const float& volume, const float& pressure, const float& time);
+
+  // Finish the breath and update the estimates
+  void endBreath();
+
+  // Check if the estimates are valid
+  inline const bool& valid() const { return valid_; }
+
+  // Compliance in mL/cmH2O
+  inline const float& compliance() const { return compliance_; }
+
+  // Resistance in cmH2O/(L/s)
+  inline const float& resistance() const { return resistance_; }
+
+  // Time constant R*C in seconds
+  inline const float& timeConstant() const { return time_constant_; }
+
+  // Pressure (cmH2O) at zero volume and flow, i.e. the fitted PEEP
+  inline const float& peep() const { return peep_; }
+
+private:
+  // Sums of the breath in progress
+  struct Sums {
+    int32_t n, v, q, p, vv, qq, vq, vp, qp;
+  } breath_;
+
+  // Blended statistics of all breaths, same order as `Sums`
+  float stats_[9] = {0};
+
+  bool in_breath_ = false;
+  float volume0_, last_volume_, last_time_;
+
+  bool valid_ = false;
+  float compliance_ = 0.0;
+  float resistance_ = 0.0;
+  float time_constant_ = 0.0;
+  float peep_ = 0.0;
+};
+
+
+}  // namespace mechanics
+
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Metrics.cpp
+ */
+
+#include "Metrics.h"
+
+
+namespace metrics {
+
+
+/// SlidingSum ///
+
+template <uint8_t kLength>
+void SlidingSum<kLength>::add(const float& value) {
+  const float oldest = values_[head_];  // Zero until the window is full
+  values_[head_] = value;
+  head_ = (head_ + 1) % kLength;
+  if (count_ < kLength) {
+    count_++;
+  }
+
+  if (head_ == 0) {
+    sum_ = 0;
+    for (uint8_t i = 0; i < kLength; i++) {
+      sum_ += values_[i];
+    }
+  }
+  else {
+    sum_ += value - oldest;
+  }
+}
+
+template <uint8_t kLength>
+void SlidingSum<kLength>::reset() {
+  for (uint8_t i = 0; i < kLength; i++) {
+    values_[i] = 0;
+  }
+  sum_ = 0;
+  head_ = 0;
+  count_ = 0;
+}
+
+
+/// BreathMetrics ///
+
+void BreathMetrics::addBreath(const float& period, const float& t_in, const float& volume,
+                              const bool& triggered) {
+  periods_.add(period);
+  inhales_.add(t_in);
+  volumes_.add(volume);
+  triggered_.add(triggered ? 1 : 0);
+
+  const float n = periods_.size();
+  const float total_time = periods_.sum();
+  const float total_in = inhales_.sum();
+  rate_ = total_time > 0 ? 60 * n / total_time : 0;
+  ie_ratio_ = total_in > 0 ? (total_time - total_in) / total_in : 0;
+  tidal_volume_ = volumes_.sum() / n;
+  minute_ventilation_ = total_time > 0 ? 60 * volumes_.sum() / total_time / 1000 : 0;
+  spontaneous_fraction_ = triggered_.sum() / n;
+}
+
+void BreathMetrics::reset() {
+  periods_.reset();
+  inhales_.reset();
+  volumes_.reset();
+  triggered_.reset();
+  rate_ = ie_ratio_ = tidal_volume_ = minute_ventilation_ = spontaneous_fraction_ = 0;
+}
+
+
+}  // namespace metrics
@@ -0,0 +1,124 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Metrics.h
+ * Ventilation metrics derived from the measured breaths.
+ */
+
+#ifndef Metrics_h
+#define Metrics_h
+
+#include "Arduino.h"
+
+
+namespace metrics {
+
+
+/**
+ * SlidingSum
+ * Sum of the last kLength values, updated in constant time per value. The sum is
+ * recomputed from the stored values once per wrap so float rounding cannot build up.
+ */
+template <uint8_t kLength>
+class SlidingSum {
+public:
+  // Add a value, dropping the oldest one if full
+  void add(const float& value);
+
+  // Forget all values
+  void reset();
+
+  // Sum of the values in the window
+  inline float sum() const { return sum_; }
+
+  // Number of values in the window
+  inline uint8_t size() const { return count_; }
+
+private:
+  float values_[kLength] = {};
+  float sum_ = 0;
+  uint8_t head_ = 0;
+  uint8_t count_ = 0;
+};
+
+
+/**
+ * BreathMetrics
+ * Rolling measured rate, I:E ratio, tidal volume, minute ventilation and fraction
+ * of patient-triggered breaths over the last kWindow breaths. The metrics are
+ * computed once per breath from sliding sums, so reading them costs nothing and
+ * they can be registered with the logger by reference.
+ */
+class BreathMetrics {
+public:
+  // Number of breaths in the window
+  static const uint8_t kWindow = 8;
+
+  // Add a completed breath: period and inspiratory time (s), delivered volume (mL)
+  // and whether the patient triggered it
+  void addBreath(const float& period, const float& t_in, const float& volume,
+                 const bool& triggered);
+
+  // Forget all breaths, e.g. when ventilation stops
+  void reset();
+
+  // Check if there are breaths in the window
+  inline bool valid() const { return periods_.size() > 0; }
+
+  // Respiratory rate (bpm)
+  inline const float& rate() const { return rate_; }
+
+  // Expiratory over inspiratory time, as in 1:ie
+  inline const float& ieRatio() const { return ie_ratio_; }
+
+  // Tidal volume (mL)
+  inline const float& tidalVolume() const { return tidal_volume_; }
+
+  // Minute ventilation (L/min)
+  inline const float& minuteVentilation() const { return minute_ventilation_; }
+
+  // Fraction of breaths triggered by the patient
+  inline const float& spontaneousFraction() const { return spontaneous_fraction_; }
+
+private:
+  SlidingSum<kWindow> periods_;
+  SlidingSum<kWindow> inhales_;
+  SlidingSum<kWindow> volumes_;
+  SlidingSum<kWindow> triggered_;
+
+  float rate_ = 0;
+  float ie_ratio_ = 0;
+  float tidal_volume_ = 0;
+  float minute_ventilation_ = 0;
+  float spontaneous_fraction_ = 0;
+};
+
+
+}  // namespace metrics
+
+
+#endif
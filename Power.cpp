@@ -0,0 +1,106 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Power.cpp
+ */
+
+#include "Power.h"
+
+#include <avr/sleep.h>
+
+
+namespace power {
+
+
+void idle(const unsigned long& duration_us) {
+  const unsigned long start = micros();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (micros() - start < duration_us) {
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+  }
+}
+
+
+/// DutyCycle ///
+
+void DutyCycle::beginTick(const States& state) {
+  const unsigned long now_us = micros();
+  if (state_ < NUM_STATES) {
+    awake_us_[state_] += work_end_ - tick_start_;
+    total_us_[state_] += now_us - tick_start_;
+    if (total_us_[state_] & 0x80000000UL) {
+      awake_us_[state_] >>= 1;
+      total_us_[state_] >>= 1;
+    }
+  }
+  state_ = state;
+  tick_start_ = work_end_ = now_us;
+}
+
+void DutyCycle::endWork() {
+  work_end_ = micros();
+}
+
+float DutyCycle::duty(const States& state) const {
+  return total_us_[state] > 0 ? (float)awake_us_[state] / total_us_[state] : 0;
+}
+
+float DutyCycle::current(const States& state) const {
+  const float d = duty(state);
+  return d * kActiveCurrent + (1 - d) * kIdleCurrent;
+}
+
+bool DutyCycle::printPage(Print& out, const uint8_t& page) const {
+  if (page == 0) {
+    out.println("State,Duty,Current(mA),Time(s)");
+    return true;
+  }
+  const States state = (States)(page - 1);
+  if (total_us_[state] > 0) {
+    out.print(page - 1);
+    out.print(',');
+    out.print(duty(state), 3);
+    out.print(',');
+    out.print(current(state), 1);
+    out.print(',');
+    out.println(total_us_[state] / 1e6, 1);
+  }
+  return page < NUM_STATES;
+}
+
+void DutyCycle::reset() {
+  for (int i = 0; i < NUM_STATES; i++) {
+    awake_us_[i] = 0;
+    total_us_[i] = 0;
+  }
+  state_ = NUM_STATES;
+}
+
+
+}  // namespace power
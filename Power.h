@@ -0,0 +1,92 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Power.h
+ * Sleeps the MCU between control loop ticks and measures how long it is awake.
+ */
+
+#ifndef Power_h
+#define Power_h
+
+#include "Arduino.h"
+
+#include "Constants.h"
+
+
+namespace power {
+
+
+// Supply current (mA) of the MCU at 16 MHz and 5 V, datasheet typical values
+static constexpr float kActiveCurrent = 14.0;
+static constexpr float kIdleCurrent = 4.0;
+
+// Sleep in idle mode for the given time (us). Timer0 and the sampling timer keep
+// running and wake the CPU at least every millisecond, so it goes back to sleep
+// until the time is up. Interrupts must be enabled.
+void idle(const unsigned long& duration_us);
+
+
+/**
+ * DutyCycle
+ * Time awake and total time per state, from the start of each loop tick and the
+ * end of its work. The sums are halved together before they overflow, so the
+ * duty cycle keeps following recent ticks.
+ */
+class DutyCycle {
+public:
+  // Start a loop tick in the given state, ending the previous one
+  void beginTick(const States& state);
+
+  // End the work of the current tick, the rest of it is idle
+  void endWork();
+
+  // Fraction of the time awake in a state
+  float duty(const States& state) const;
+
+  // Estimated average MCU current (mA) in a state
+  float current(const States& state) const;
+
+  // Print the duty cycle and current per state, the header (page 0) or the row of
+  // one state (page 1 on). Returns false if it was the last page.
+  bool printPage(Print& out, const uint8_t& page) const;
+
+  // Forget all ticks
+  void reset();
+
+private:
+  uint32_t awake_us_[NUM_STATES] = {};
+  uint32_t total_us_[NUM_STATES] = {};
+  States state_ = NUM_STATES;
+  unsigned long tick_start_ = 0;
+  unsigned long work_end_ = 0;
+};
+
+
+}  // namespace power
+
+
+#endif
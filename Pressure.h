@@ -27,6 +27,8 @@
 /**
  * Pressure.h
  * Calculates and stores the key pressure values of the breathing cycle.
+ * Plateau and PEEP are averaged over the samples of their hold windows.
+ * Conversions are relative to the calibrated sensor zero.
  */
 
 #ifndef Pressure_h
@@ -34,51 +36,136 @@
 
 #include "Arduino.h"
 
+#include "Calibration.h"
+#include "Sampling.h"
+
 class Pressure {
+  // Sensor range in mmHg over the 0.1-0.9 fraction of the ADC range
+  static constexpr float kPmin = -100.0;
+  static constexpr float kPmax = 100.0;
+  static constexpr float kVmax = 1024;         // max voltage in range from analogRead
+  static constexpr float kMmHgToCmH2O = 1.01972;
+
+  // Time (ms) skipped at the start of the plateau and PEEP windows while pressure settles
+  static const unsigned long kSettleTime = 20;
+  static const uint8_t kSettleSamples = kSettleTime * sampling::AdcSampler::kPressureRate / 1000;
+
+  // Running mean of the raw samples in a window, skipping the first few
+  struct Window {
+    uint32_t sum = 0;
+    uint16_t count = 0;
+    uint8_t skip = 0;
+    bool open = false;
+
+    inline void start(const uint8_t settle) {
+      sum = 0;
+      count = 0;
+      skip = settle;
+      open = true;
+    }
+
+    inline void add(const uint16_t& raw) {
+      if (!open) return;
+      if (skip > 0) {
+        skip--;
+        return;
+      }
+      sum += raw;
+      count++;
+    }
+
+    inline bool empty() const { return count == 0; }
+
+    inline float mean() const { return (float)sum / count; }
+  };
+
 public:
-  Pressure(int pin): 
-    sense_pin_(pin),
+  // Raw ADC reading at atmospheric pressure for an ideal sensor
+  static constexpr float kNominalZero = (-kPmin * 8. / (kPmax - kPmin) + 1) * kVmax / 10;
+
+  // Pressure (cmH2O) per ADC count
+  static constexpr float kCmH2OPerCount = 10 / kVmax * (kPmax - kPmin) / 8. * kMmHgToCmH2O;
+
+  Pressure(const sampling::AdcSampler* sampler): 
+    sampler_(sampler),
     current_(0.0),
     current_peak_(0.0),
     peak_(0.0),
     plateau_(0.0),
     peep_(0.0) {}
 
-  //Get pressure reading
-  void read() {
-    // read the voltage
-    int V = analogRead(sense_pin_); 
-
-    float Pmin = -100.0;   // pressure max in mbar
-    float Pmax = 100.0;    // pressure min in mbar
-    float Vmax = 1024;     // max voltage in range from analogRead
-    // convert to pressure
-    float pres = (10 * V/Vmax - 1) * (Pmax-Pmin)/8. + Pmin; //mmHg
-
-    // convert to cmH20
-    pres *= 1.01972;
+  // Convert a raw ADC reading to pressure in cmH2O
+  static float toPressure(const float& raw) {
+    return (16 * raw - calibration::zero_q4) * (kCmH2OPerCount / 16);
+  }
 
-    // update peak
-    current_peak_ = max(current_peak_, pres);
+  // Convert a pressure in cmH2O to the smallest raw ADC reading at or above it
+  static uint16_t toRaw(const float& pres) {
+    const float raw_q4 = calibration::zero_q4 + pres * (16 / kCmH2OPerCount);
+    return constrain(ceil(raw_q4 / 16), 0, kVmax - 1);
+  }
 
-    current_ = pres;
+  //Get pressure reading
+  void read() {
+    // Consume the samples taken since the last read, dropping any overwritten ones
+    const uint8_t head = sampler_->head();
+    if ((uint8_t)(head - tail_) >= sampling::AdcSampler::kBufferSize) {
+      tail_ = head - (sampling::AdcSampler::kBufferSize - 1);
+    }
+    if (tail_ == head) {
+      return;
+    }
+    uint16_t raw, raw_max = 0;
+    while (tail_ != head) {
+      raw = sampler_->at(tail_++);
+      raw_max = max(raw_max, raw);
+      plateau_window_.add(raw);
+      peep_window_.add(raw);
+    }
+
+    // update peak with the highest sample, not just the latest
+    current_peak_ = max(current_peak_, toPressure(raw_max));
+    recent_max_ = toPressure(raw_max);
+
+    current_ = toPressure(raw);
   }
 
   const float& get() {
     return current_;
   }
 
+  // Highest pressure among the samples consumed by the last read
+  const float& recentMax() {
+    return recent_max_;
+  }
+
+  // Called at the start of each breath, also ends the PEEP window
   void set_peak_and_reset() {
     peak_ = current_peak_;
     current_peak_ = 0.0;
+    peep_window_.open = false;
   }
 
+  // Start averaging samples for the plateau, at the start of the inspiratory hold
+  void start_plateau_window() {
+    plateau_window_.start(kSettleSamples);
+  }
+
+  // Set the plateau to the mean of its window, or to the current value if it is empty
   void set_plateau() {
-    plateau_ = get();
+    plateau_ = plateau_window_.empty() ? get() : toPressure(plateau_window_.mean());
+    plateau_window_.open = false;
+  }
+
+  // Start averaging samples for PEEP, at the start of the expiratory pause
+  void start_peep_window() {
+    peep_window_.start(kSettleSamples);
   }
 
+  // Set PEEP to the mean of its window so far, or to the current value if it is empty.
+  // The window stays open so that a later call averages over a longer pause.
   void set_peep() {
-    peep_ = get();
+    peep_ = peep_window_.empty() ? get() : toPressure(peep_window_.mean());
   }
 
   const float& peak() { return peak_; }
@@ -86,10 +173,13 @@ public:
   const float& peep() { return peep_; }
 
 private:
-  int sense_pin_;
+  const sampling::AdcSampler* sampler_;
+  uint8_t tail_ = 0;
   float current_;
   float current_peak_;
+  float recent_max_ = 0.0;
   float peak_, plateau_, peep_;
+  Window plateau_window_, peep_window_;
 };
 
 #endif
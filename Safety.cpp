@@ -0,0 +1,96 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Safety.cpp
+ */
+
+#include "Safety.h"
+
+#include <util/atomic.h>
+
+#include "Pressure.h"
+
+
+namespace safety {
+
+
+/// OverpressureCutoff ///
+
+void OverpressureCutoff::begin(const long& retract_pos, const long& vel, const long& acc) {
+  utils::preparePosition(retract_, retract_pos, vel, acc);
+}
+
+bool OverpressureCutoff::check(const uint16_t& raw) {
+  if (!armed_ || raw < threshold_raw_) {
+    return false;
+  }
+  armed_ = false;
+  tripped_ = true;
+  trip_time_ = micros();
+  roboclaw_->WritePacketFromISR(retract_.packet, retract_.length);
+  return true;
+}
+
+void OverpressureCutoff::arm() {
+  // Converted on every arm so the threshold follows the sensor zero
+  const uint16_t threshold_raw = Pressure::toRaw(max_pressure_);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    threshold_raw_ = threshold_raw;
+    armed_ = retract_.ready();
+  }
+}
+
+void OverpressureCutoff::disarm() {
+  armed_ = false;
+}
+
+bool OverpressureCutoff::consumeTrip() {
+  bool tripped;
+  unsigned long trip_time;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    tripped = tripped_;
+    trip_time = trip_time_;
+    tripped_ = false;
+  }
+  if (tripped) {
+    // The packet may have been deferred behind a transaction, so ask when it went out
+    last_latency_ = roboclaw_->UrgentSentMicros() - trip_time;
+    max_latency_ = max(max_latency_, last_latency_);
+  }
+  return tripped;
+}
+
+void OverpressureCutoff::print(Print& out) const {
+  out.print("Cutoff latency(us) last=");
+  out.print(last_latency_);
+  out.print(" max=");
+  out.print(max_latency_);
+  out.println(" (to queued, add ~5.5ms on the wire)");
+}
+
+
+}  // namespace safety
@@ -0,0 +1,102 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Safety.h
+ * Fast-path safety checks that run in the sampling interrupt, ahead of the control loop.
+ */
+
+#ifndef Safety_h
+#define Safety_h
+
+#include "Arduino.h"
+#include "src/thirdparty/RoboClaw/RoboClaw.h"
+
+#include "Utilities.h"
+
+
+namespace safety {
+
+
+/**
+ * OverpressureCutoff
+ * Watches every raw pressure sample and, the first time it reaches the threshold
+ * after being armed, sends a pre-encoded retract packet to the RoboClaw straight
+ * from the sampling interrupt. The control loop then acknowledges the trip and
+ * takes over the exhalation as usual.
+ */
+class OverpressureCutoff {
+public:
+  OverpressureCutoff(RoboClaw* roboclaw, const float& max_pressure):
+      roboclaw_(roboclaw),
+      max_pressure_(max_pressure) {}
+
+  // Encode the retract packet, called during arduino setup()
+  void begin(const long& retract_pos, const long& vel, const long& acc);
+
+  // Check a raw pressure sample and return whether it tripped the cutoff,
+  // only to be called from the sampling interrupt
+  bool check(const uint16_t& raw);
+
+  // Start watching, e.g. at the start of each breath once the motor is homed
+  void arm();
+
+  // Stop watching, e.g. while homing when a position command would be wrong
+  void disarm();
+
+  // Check if the cutoff tripped since last called, and clear the trip
+  bool consumeTrip();
+
+  // Time (us) from the interrupt that saw the offending sample to the last byte of the
+  // retract packet being queued on the serial port, for the last trip. It includes any
+  // wait behind a transaction in progress, but not the up to 2ms before the sample is
+  // taken or the packet time on the wire (21 bytes, ~5.5ms at 38400 baud).
+  inline const unsigned long& lastLatency() const { return last_latency_; }
+
+  // Worst latency (us) seen since startup
+  inline const unsigned long& maxLatency() const { return max_latency_; }
+
+  // Print the last and worst latency with what they cover
+  void print(Print& out) const;
+
+private:
+  RoboClaw* roboclaw_;
+  const float max_pressure_;
+  uint16_t threshold_raw_;
+  utils::MotionCommand retract_;
+
+  volatile bool armed_ = false;
+  volatile bool tripped_ = false;
+  volatile unsigned long trip_time_ = 0;
+  unsigned long last_latency_ = 0;
+  unsigned long max_latency_ = 0;
+};
+
+
+}  // namespace safety
+
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Sampling.cpp
+ */
+
+#include "Sampling.h"
+
+#include <util/atomic.h>
+
+
+namespace sampling {
+
+
+AdcSampler sampler;
+
+
+/// AdcSampler ///
+
+namespace {
+
+// ADC channel of an analog pin (as in analogRead)
+inline uint8_t toChannel(const int& pin) { return pin >= A0 ? pin - A0 : pin; }
+
+}  // namespace
+
+void AdcSampler::begin(const int& pressure_pin, const int knob_pins[], const uint8_t& num_knobs) {
+  // Seed all values with a blocking read so they are valid before the first trigger
+  pressure_channel_ = toChannel(pressure_pin);
+  num_knobs_ = num_knobs;
+  if (num_knobs_ > kMaxKnobs) num_knobs_ = kMaxKnobs;
+  for (uint8_t i = 0; i < num_knobs_; i++) {
+    knob_channels_[i] = toChannel(knob_pins[i]);
+    knob_values_[i] = analogRead(knob_pins[i]);
+  }
+  const uint16_t raw = analogRead(pressure_pin);
+  for (uint8_t i = 0; i < kBufferSize; i++) {
+    buffer_[i] = raw;
+  }
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    // Timer1 in CTC mode at kTriggerRate, prescaler 64
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+    TCNT1 = 0;
+    OCR1A = F_CPU / 64 / kTriggerRate - 1;
+    OCR1B = OCR1A;
+    TIMSK1 = _BV(OCIE1B);
+
+    // ADC auto triggered by Timer1 compare match B, 125kHz ADC clock
+    pressure_slot_ = true;
+    select(pressure_channel_);
+    ADCSRB = (ADCSRB & ~(_BV(ADTS2) | _BV(ADTS1) | _BV(ADTS0))) | _BV(ADTS2) | _BV(ADTS0);
+    ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  }
+}
+
+uint16_t AdcSampler::latest(const int& pin) const {
+  const uint8_t channel = toChannel(pin);
+  uint16_t value = 0;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (channel == pressure_channel_) {
+      value = buffer_[(uint8_t)(head_ - 1) & (kBufferSize - 1)];
+    }
+    for (uint8_t i = 0; i < num_knobs_; i++) {
+      if (knob_channels_[i] == channel) {
+        value = knob_values_[i];
+      }
+    }
+  }
+  return value;
+}
+
+uint16_t AdcSampler::at(const uint8_t& seq) const {
+  uint16_t value;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    value = buffer_[seq & (kBufferSize - 1)];
+  }
+  return value;
+}
+
+void AdcSampler::handleConversion() {
+  const uint16_t raw = ADC;
+  const bool was_pressure = pressure_slot_;
+  if (was_pressure) {
+    buffer_[head_ & (kBufferSize - 1)] = raw;
+    head_++;
+  }
+  else {
+    knob_values_[knob_index_] = raw;
+    knob_index_ = (knob_index_ + 1) % num_knobs_;
+  }
+
+  // Set up the next conversion before handing the sample out
+  pressure_slot_ = !pressure_slot_ || num_knobs_ == 0;
+  select(pressure_slot_ ? pressure_channel_ : knob_channels_[knob_index_]);
+
+  if (was_pressure && callback_ != nullptr) {
+    callback_(raw);
+  }
+}
+
+void AdcSampler::select(const uint8_t& channel) {
+  ADMUX = _BV(REFS0) | (channel & 0x07);
+  if (channel & 0x08) {
+    ADCSRB |= _BV(MUX5);
+  }
+  else {
+    ADCSRB &= ~_BV(MUX5);
+  }
+}
+
+
+}  // namespace sampling
+
+
+// The compare match flag must be cleared for the next conversion to be triggered
+EMPTY_INTERRUPT(TIMER1_COMPB_vect);
+
+ISR(ADC_vect) {
+  sampling::sampler.handleConversion();
+}
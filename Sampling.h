@@ -0,0 +1,107 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Sampling.h
+ * Owns the ADC. Conversions are triggered by a hardware timer so the pressure sensor
+ * is sampled at a fixed high rate independently of the control loop, with the knob
+ * pots interleaved at a lower rate. Pressure samples are kept in a ring buffer for
+ * the main loop and can be handed to a callback in interrupt context.
+ */
+
+#ifndef Sampling_h
+#define Sampling_h
+
+#include "Arduino.h"
+
+
+namespace sampling {
+
+
+/**
+ * AdcSampler
+ * Timer-triggered ADC sampling of the pressure sensor and the knob pots.
+ * Even trigger slots convert the pressure pin, odd slots rotate through the knobs.
+ * `analogRead()` must not be used anywhere else once `begin()` was called.
+ */
+class AdcSampler {
+public:
+  // Conversions triggered per second (Timer1 compare match B)
+  static const unsigned long kTriggerRate = 1000;
+
+  // Pressure samples per second
+  static const unsigned long kPressureRate = kTriggerRate / 2;
+
+  // Number of pressure samples buffered, must be a power of 2
+  static const uint8_t kBufferSize = 32;
+
+  // Maximum number of knob pins interleaved with the pressure samples
+  static const uint8_t kMaxKnobs = 4;
+
+  // Start sampling, called during arduino setup()
+  void begin(const int& pressure_pin, const int knob_pins[], const uint8_t& num_knobs);
+
+  // Set a function called in interrupt context with every raw pressure sample
+  inline void setPressureCallback(void (*callback)(const uint16_t& raw)) { callback_ = callback; }
+
+  // Latest raw reading (0-1023) of the given pin
+  uint16_t latest(const int& pin) const;
+
+  // Sequence number of the next pressure sample to be written (wraps at 256)
+  inline uint8_t head() const { return head_; }
+
+  // Raw pressure sample with the given sequence number, valid for the last
+  // `kBufferSize - 1` samples
+  uint16_t at(const uint8_t& seq) const;
+
+  // Handle a finished conversion, only to be called from the ADC interrupt
+  void handleConversion();
+
+private:
+  uint8_t pressure_channel_;
+  uint8_t knob_channels_[kMaxKnobs];
+  volatile uint16_t knob_values_[kMaxKnobs];
+  uint8_t num_knobs_ = 0;
+  uint8_t knob_index_ = 0;
+  bool pressure_slot_ = true;
+
+  volatile uint16_t buffer_[kBufferSize];
+  volatile uint8_t head_ = 0;
+
+  void (*callback_)(const uint16_t& raw) = nullptr;
+
+  // Point the multiplexer to the given channel for the next conversion
+  void select(const uint8_t& channel);
+};
+
+// The sampler driven by the ADC interrupt
+extern AdcSampler sampler;
+
+
+}  // namespace sampling
+
+
+#endif
@@ -0,0 +1,158 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Shell.cpp
+ */
+
+#include "Shell.h"
+
+
+namespace shell {
+
+
+/// Shell ///
+
+bool Shell::addCommand(const char* name, Handler handler, const char* help) {
+  if (num_commands_ >= kMaxCommands) {
+    return false;
+  }
+  commands_[num_commands_++] = Command{name, handler, help};
+  return true;
+}
+
+bool Shell::page(Pager pager) {
+  if (pager_ != nullptr || help_) {
+    return false;
+  }
+  pager_ = pager;
+  page_ = 0;
+  return true;
+}
+
+void Shell::update() {
+  if (!page_buffer_.send(stream_)) {
+    return;
+  }
+  if (pager_ != nullptr || help_) {
+    nextPage();
+    return;
+  }
+  for (uint8_t i = 0; i <= kLineLength && stream_->available() > 0; i++) {
+    const char c = stream_->read();
+    if (c == '\n' || c == '\r') {
+      if (overflow_) {
+        stream_->println("line too long");
+      }
+      else if (length_ > 0) {
+        line_[length_] = '\0';
+        execute();
+      }
+      length_ = 0;
+      overflow_ = false;
+      return;  // One command per update
+    }
+    if (length_ < kLineLength) {
+      line_[length_++] = c;
+    }
+    else {
+      overflow_ = true;
+    }
+  }
+}
+
+void Shell::execute() {
+  char* argv[kMaxArgs];
+  uint8_t argc = 0;
+  char* c = line_;
+  while (*c != '\0') {
+    while (*c == ' ') *c++ = '\0';
+    if (*c == '\0') break;
+    if (argc == kMaxArgs) {
+      stream_->println("too many arguments");
+      return;
+    }
+    argv[argc++] = c;
+    while (*c != '\0' && *c != ' ') c++;
+  }
+  if (argc == 0) {
+    return;
+  }
+
+  if (strcmp(argv[0], "help") == 0) {
+    help_ = num_commands_ > 0;
+    page_ = 0;
+    return;
+  }
+  for (uint8_t i = 0; i < num_commands_; i++) {
+    if (strcmp(argv[0], commands_[i].name) == 0) {
+      commands_[i].handler(argc, argv, *stream_);
+      return;
+    }
+  }
+  stream_->println("unknown command, try help");
+}
+
+void Shell::nextPage() {
+  const uint8_t page = page_++;
+  if (help_) {
+    page_buffer_.print(commands_[page].name);
+    page_buffer_.print(": ");
+    page_buffer_.println(commands_[page].help);
+    help_ = page_ < num_commands_;
+  }
+  else if (!pager_(page, page_buffer_)) {
+    pager_ = nullptr;
+  }
+  page_buffer_.send(stream_);
+}
+
+
+/// PageBuffer ///
+
+size_t Shell::PageBuffer::write(uint8_t c) {
+  if (length_ == kPageLength) {
+    return 0;
+  }
+  data_[length_++] = c;
+  return 1;
+}
+
+bool Shell::PageBuffer::send(Stream* stream) {
+  int room = stream->availableForWrite();
+  while (sent_ < length_ && room-- > 0) {
+    stream->write(data_[sent_++]);
+  }
+  if (sent_ < length_) {
+    return false;
+  }
+  length_ = 0;
+  sent_ = 0;
+  return true;
+}
+
+
+}  // namespace shell
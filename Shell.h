@@ -0,0 +1,131 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Shell.h
+ * Non-blocking line-based command shell over serial.
+ */
+
+#ifndef Shell_h
+#define Shell_h
+
+#include "Arduino.h"
+
+
+namespace shell {
+
+
+/**
+ * Shell
+ * Each update consumes at most a line worth of the bytes already received into a
+ * fixed buffer, and runs the command once the line ends, so it never waits for
+ * input and never allocates. Commands are registered as a name, a handler that
+ * takes the words of the line split in place, and a help text.
+ *
+ * Handlers print short replies directly. Long outputs, like the help, are printed
+ * one page per update by a pager into a buffer, and the buffer is only written
+ * out as far as the serial output buffer has room, so a dump never blocks the
+ * loop. No new command runs until a paged output is sent.
+ */
+class Shell {
+public:
+  // Longest line accepted, longer lines are dropped
+  static const uint8_t kLineLength = 32;
+
+  // Maximum number of words in a line, including the command
+  static const uint8_t kMaxArgs = 4;
+
+  // Maximum number of commands
+  static const uint8_t kMaxCommands = 12;
+
+  // Longest page of a paged output, longer pages are cut
+  static const uint8_t kPageLength = 128;
+
+  // Command handler, argv[0] is the command name
+  typedef void (*Handler)(const uint8_t& argc, char* argv[], Print& out);
+
+  // Prints a page of a long output, returns false if it was the last one
+  typedef bool (*Pager)(const uint8_t& page, Print& out);
+
+  explicit Shell(Stream* stream): stream_(stream) {}
+
+  // Register a command, returns false if there is no room for it
+  bool addCommand(const char* name, Handler handler, const char* help);
+
+  // Update during arduino loop(), runs at most one command or prints one page
+  void update();
+
+  // Print a long output with a pager from the next update on, from a command
+  // handler. Returns false if another one is being printed.
+  bool page(Pager pager);
+
+private:
+  // Page being printed, sent as the serial output buffer drains
+  class PageBuffer : public Print {
+  public:
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    // Write as much as fits without blocking, returns true once all is sent
+    bool send(Stream* stream);
+
+  private:
+    char data_[kPageLength];
+    uint8_t length_ = 0;
+    uint8_t sent_ = 0;
+  };
+
+  struct Command {
+    const char* name;
+    Handler handler;
+    const char* help;
+  };
+
+  Stream* stream_;
+  Command commands_[kMaxCommands];
+  uint8_t num_commands_ = 0;
+
+  PageBuffer page_buffer_;
+  Pager pager_ = nullptr;
+  bool help_ = false;  // Paging the help, one command per page
+  uint8_t page_ = 0;
+
+  char line_[kLineLength + 1];
+  uint8_t length_ = 0;
+  bool overflow_ = false;
+
+  // Split the line into words and run its command
+  void execute();
+
+  // Print the next page of the output being paged, if any
+  void nextPage();
+};
+
+
+}  // namespace shell
+
+
+#endif
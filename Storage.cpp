@@ -0,0 +1,234 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Storage.cpp
+ */
+
+#include "Storage.h"
+
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+
+namespace storage {
+
+
+/// RecordStore ///
+
+void RecordStore::begin() {
+  // The valid bank with the newest generation is active
+  uint16_t gen0, gen1;
+  const bool valid0 = readHeader(0, gen0);
+  const bool valid1 = readHeader(1, gen1);
+  if (!valid0 && !valid1) {
+    // Blank EEPROM, compacting no values into bank 0 just writes its header
+    bank_ = 1;
+    generation_ = 0;
+    append_ = kBankSize;
+    compacting_ = true;
+    compact_key_ = 0;
+    compact_offset_ = kHeaderSize;
+    return;
+  }
+  bank_ = (valid1 && (!valid0 || (int16_t)(gen1 - gen0) > 0)) ? 1 : 0;
+  generation_ = bank_ ? gen1 : gen0;
+
+  // Replay the records until the end marker, or one of another generation or erased
+  uint16_t offset = kHeaderSize;
+  uint8_t record[kRecordSize];
+  while (offset + kRecordSize <= kBankSize) {
+    eeprom_read_block(record, (const void*)(bank_ * kBankSize + offset), kRecordSize);
+    const uint8_t key = record[0] & ~kErased;
+    if (key >= NUM_KEYS || record[kRecordSize - 1] != check(record, kRecordSize - 1, generation_)) {
+      break;
+    }
+    if (record[0] & kErased) {
+      valid_ &= ~(1 << key);
+    }
+    else {
+      memcpy(&values_[key], &record[1], sizeof(uint32_t));
+      valid_ |= 1 << key;
+    }
+    offset += kRecordSize;
+  }
+  append_ = offset;
+}
+
+void RecordStore::update() {
+  if (!eeprom_is_ready()) {
+    return;
+  }
+  if (written_ == length_) {
+    length_ = written_ = 0;
+    nextWrite();
+    if (length_ == 0) {
+      return;
+    }
+  }
+  // Only rewrites the byte if it differs, and returns right away as the EEPROM is idle
+  eeprom_update_byte((uint8_t*)(address_ + written_), buffer_[written_]);
+  written_++;
+}
+
+float RecordStore::getFloat(const Key& key) const {
+  float value;
+  memcpy(&value, &values_[key], sizeof(value));
+  return value;
+}
+
+void RecordStore::set(const Key& key, const uint32_t& value) {
+  if (has(key) && values_[key] == value) {
+    return;
+  }
+  values_[key] = value;
+  valid_ |= 1 << key;
+  dirty_ |= 1 << key;
+}
+
+void RecordStore::setFloat(const Key& key, const float& value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  set(key, bits);
+}
+
+void RecordStore::erase(const Key& key) {
+  if (!has(key)) {
+    return;
+  }
+  valid_ &= ~(1 << key);
+  dirty_ |= 1 << key;
+}
+
+void RecordStore::startWrite(const uint16_t& address, const uint8_t& length) {
+  address_ = address;
+  length_ = length;
+  written_ = 0;
+}
+
+void RecordStore::encodeRecord(const uint8_t& key, const uint16_t& generation) {
+  buffer_[0] = has((Key)key) ? key : key | kErased;
+  memcpy(&buffer_[1], &values_[key], sizeof(uint32_t));
+  buffer_[kRecordSize - 1] = check(buffer_, kRecordSize - 1, generation);
+}
+
+void RecordStore::nextWrite() {
+  const uint8_t other = 1 - bank_;
+
+  if (compacting_) {
+    // Latest value of each key, the end marker, then the header that makes the bank active
+    while (compact_key_ < NUM_KEYS && !has((Key)compact_key_)) {
+      compact_key_++;
+    }
+    if (compact_key_ < NUM_KEYS) {
+      encodeRecord(compact_key_, generation_ + 1);
+      dirty_ &= ~(1 << compact_key_);
+      startWrite(other * kBankSize + compact_offset_, kRecordSize);
+      compact_offset_ += kRecordSize;
+      compact_key_++;
+    }
+    else if (compact_key_ == NUM_KEYS) {
+      compact_key_++;
+      if (!markEnd(other, compact_offset_)) {
+        nextWrite();
+      }
+    }
+    else if (compact_key_ == NUM_KEYS + 1) {
+      buffer_[0] = kMagic;
+      buffer_[1] = (generation_ + 1) & 0xFF;
+      buffer_[2] = (generation_ + 1) >> 8;
+      buffer_[3] = check(buffer_, kHeaderSize - 1, 0);
+      startWrite(other * kBankSize, kHeaderSize);
+      compact_key_++;
+    }
+    else {
+      // Header written
+      compacting_ = false;
+      bank_ = other;
+      generation_++;
+      append_ = compact_offset_;
+      end_marked_ = false;
+      nextWrite();
+    }
+    return;
+  }
+
+  if (dirty_ == 0) {
+    return;
+  }
+  if (append_ + kRecordSize > kBankSize) {
+    compacting_ = true;
+    compact_key_ = 0;
+    compact_offset_ = kHeaderSize;
+    nextWrite();
+    return;
+  }
+  if (!end_marked_) {
+    // First, so a reset midway through the record still leaves the log terminated
+    end_marked_ = true;
+    if (markEnd(bank_, append_ + kRecordSize)) {
+      return;
+    }
+  }
+  end_marked_ = false;
+  uint8_t key = 0;
+  while (!(dirty_ & (1 << key))) {
+    key++;
+  }
+  encodeRecord(key, generation_);
+  dirty_ &= ~(1 << key);
+  startWrite(bank_ * kBankSize + append_, kRecordSize);
+  append_ += kRecordSize;
+}
+
+bool RecordStore::markEnd(const uint8_t& bank, const uint16_t& offset) {
+  if (offset + kRecordSize > kBankSize) {
+    return false;  // No slot left, the replay stops at the end of the bank
+  }
+  buffer_[0] = kEnd;
+  startWrite(bank * kBankSize + offset, 1);
+  return true;
+}
+
+bool RecordStore::readHeader(const uint8_t& bank, uint16_t& generation) {
+  uint8_t header[kHeaderSize];
+  eeprom_read_block(header, (const void*)(bank * kBankSize), kHeaderSize);
+  generation = header[1] | (header[2] << 8);
+  return header[0] == kMagic && header[kHeaderSize - 1] == check(header, kHeaderSize - 1, 0);
+}
+
+uint8_t RecordStore::check(const uint8_t* data, const uint8_t& length, const uint16_t& generation) {
+  // Records include their generation so stale ones of an older pass end the replay
+  uint8_t crc = _crc8_ccitt_update(0, generation & 0xFF);
+  crc = _crc8_ccitt_update(crc, generation >> 8);
+  for (uint8_t i = 0; i < length; i++) {
+    crc = _crc8_ccitt_update(crc, data[i]);
+  }
+  return crc;
+}
+
+
+}  // namespace storage
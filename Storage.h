@@ -0,0 +1,154 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Storage.h
+ * Settings, counters and calibration kept in EEPROM across resets.
+ */
+
+#ifndef Storage_h
+#define Storage_h
+
+#include "Arduino.h"
+
+
+namespace storage {
+
+
+// Stored values
+enum Key : uint8_t {
+  VOLUME_SETTING,  // Confirmed tidal volume (int)
+  BPM_SETTING,     // Confirmed respiratory rate (int)
+  IE_SETTING,      // Confirmed I:E ratio (float)
+  AC_SETTING,      // Confirmed trigger sensitivity (float)
+  TOTAL_BREATHS,   // Breaths delivered since first boot
+  ALARM_COUNT,     // Alarms triggered since first boot
+  PRESSURE_ZERO,   // Pressure sensor zero (1/16 ADC counts)
+  POSITION_KP,     // Auto-tuned position PID gains (float)
+  POSITION_KI,
+  POSITION_KD,
+  NUM_KEYS
+};
+
+
+/**
+ * RecordStore
+ * Log-structured store in two EEPROM banks. A bank starts with a header holding a
+ * generation number, followed by 6-byte records (key, 4-byte value, CRC). A new
+ * value is appended as a record to the active bank, and the last record of each
+ * key wins on boot. When the active bank is full, the latest value of every key
+ * is compacted into the other bank and its header is written last with the next
+ * generation, so a reset midway leaves the previous bank in charge. Appends sweep
+ * the whole bank between compactions, which spreads the wear over every cell.
+ *
+ * An erased key is appended as a record with the kErased bit set in its key, and
+ * compaction leaves it out.
+ *
+ * The log is terminated by a kEnd key byte in the slot after the last record, so
+ * stale records of an earlier pass never replay even if their CRC happens to match.
+ * Each append writes the end marker of the next slot before its own record, and
+ * compaction writes one after the last record before the header.
+ *
+ * `set()` only updates RAM, `update()` writes at most one byte per call and only
+ * when the EEPROM is idle, so a write (3.3 ms) never stalls the control loop.
+ */
+class RecordStore {
+public:
+  // Load the latest values, during arduino setup()
+  void begin();
+
+  // Write the next pending byte if the EEPROM is idle, during arduino loop()
+  void update();
+
+  // Check if a key has a stored value
+  inline bool has(const Key& key) const { return valid_ & (1 << key); }
+
+  // Get a stored value, valid only if `has(key)`
+  inline uint32_t get(const Key& key) const { return values_[key]; }
+  float getFloat(const Key& key) const;
+
+  // Set a value, queued for writing if it changed
+  void set(const Key& key, const uint32_t& value);
+  void setFloat(const Key& key, const float& value);
+
+  // Forget a stored value, queued for writing
+  void erase(const Key& key);
+
+  // Check if all values are written
+  inline bool idle() const { return dirty_ == 0 && length_ == 0 && !compacting_; }
+
+private:
+  static const uint16_t kBankSize = (E2END + 1) / 2;
+  static const uint8_t kHeaderSize = 4;
+  static const uint8_t kRecordSize = 6;
+  static const uint8_t kMagic = 0xE5;
+  static const uint8_t kErased = 0x80;  // Key flag of an erase record
+  static const uint8_t kEnd = 0xFF;     // Key byte of the slot after the last record
+
+  uint32_t values_[NUM_KEYS] = {};
+  uint16_t valid_ = 0;
+  uint16_t dirty_ = 0;
+
+  uint8_t bank_ = 0;           // Active bank
+  uint16_t generation_ = 0;    // Generation of the active bank
+  uint16_t append_ = kHeaderSize;  // Offset of the next record in the active bank
+  bool end_marked_ = false;        // End marker after the next record written
+
+  // Compaction into the other bank
+  bool compacting_ = false;
+  uint8_t compact_key_ = 0;
+  uint16_t compact_offset_ = 0;
+
+  // Bytes being written
+  uint8_t buffer_[kRecordSize];
+  uint8_t length_ = 0;
+  uint8_t written_ = 0;
+  uint16_t address_ = 0;
+
+  // Start writing bytes to the given address
+  void startWrite(const uint16_t& address, const uint8_t& length);
+
+  // Encode a record for the given generation into the buffer
+  void encodeRecord(const uint8_t& key, const uint16_t& generation);
+
+  // Pick the next bytes to write
+  void nextWrite();
+
+  // Write the end marker into the slot at the given offset, returns false if there is none
+  bool markEnd(const uint8_t& bank, const uint16_t& offset);
+
+  // Read the header of a bank, returns false if it is not valid
+  static bool readHeader(const uint8_t& bank, uint16_t& generation);
+
+  // Check byte of a header or record
+  static uint8_t check(const uint8_t* data, const uint8_t& length, const uint16_t& generation);
+};
+
+
+}  // namespace storage
+
+
+#endif
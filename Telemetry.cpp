@@ -0,0 +1,123 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Telemetry.cpp
+ */
+
+#include "Telemetry.h"
+
+
+namespace telemetry {
+
+
+namespace {
+
+const char* const kNames[NUM_QUERIES] = {"Supply(V)", "Temperature(C)", "Errors"};
+
+}  // namespace
+
+
+/// Poller ///
+
+void Poller::update(const float& spare) {
+  if (ticks_ < kPollTicks) {
+    ticks_++;
+    return;
+  }
+  if (spare < kQueryTime) {
+    return;
+  }
+  poll(static_cast<Query>(next_));
+  next_ = (next_ + 1) % NUM_QUERIES;
+  ticks_ = 0;
+}
+
+void Poller::poll(const Query& query) {
+  const uint32_t timeout = roboclaw_->GetTimeout();
+  const uint8_t retries = roboclaw_->GetRetries();
+  roboclaw_->SetReadLimits(kTimeout, 0);
+
+  bool valid = false;
+  uint32_t value;
+  switch (query) {
+    case SUPPLY_VOLTAGE:
+      value = roboclaw_->ReadMainBatteryVoltage(address_, &valid);
+      break;
+    case TEMPERATURE: {
+      uint16_t temp;
+      valid = roboclaw_->ReadTemp(address_, temp);
+      value = temp;
+      break;
+    }
+    case ERROR_STATUS:
+      value = roboclaw_->ReadError(address_, &valid);
+      break;
+    default:
+      break;
+  }
+  if (!valid) {
+    // A late reply would be taken by the next transaction and fail its CRC, so drain
+    // the replies until the line has been quiet for a kTimeout
+    while (roboclaw_->read(kTimeout) != -1) {}
+  }
+  roboclaw_->SetReadLimits(timeout, retries);
+
+  if (valid) {
+    readings_[query].value = value;
+    readings_[query].time = millis();
+    readings_[query].valid = true;
+  }
+}
+
+void Poller::print(Print& out) const {
+  out.println("Query,Value,Age(ms)");
+  for (int i = 0; i < NUM_QUERIES; i++) {
+    const Query query = static_cast<Query>(i);
+    out.print(kNames[i]);
+    out.print(',');
+    if (!has(query)) {
+      out.println("-,-");
+      continue;
+    }
+    switch (query) {
+      case SUPPLY_VOLTAGE:
+        out.print(supplyVoltage(), 1);
+        break;
+      case TEMPERATURE:
+        out.print(temperature(), 1);
+        break;
+      default:
+        out.print(errorStatus(), HEX);
+        break;
+    }
+    out.print(',');
+    out.println(age(query));
+  }
+}
+
+
+}  // namespace telemetry
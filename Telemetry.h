@@ -0,0 +1,118 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Telemetry.h
+ * Polls slow-changing RoboClaw status, one query at a time in the spare time of
+ * the control loop.
+ */
+
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include "Arduino.h"
+#include "src/thirdparty/RoboClaw/RoboClaw.h"
+
+
+namespace telemetry {
+
+
+// Slow telemetry queries, polled in this order
+enum Query {
+  SUPPLY_VOLTAGE,  // Main battery voltage
+  TEMPERATURE,     // Board temperature
+  ERROR_STATUS,    // Error and warning flags
+  NUM_QUERIES
+};
+
+
+/**
+ * Poller
+ * Sends one query every kPollTicks loop ticks, and only if the loop has at least
+ * kQueryTime left, so the round trip never delays the next tick. If there is no
+ * time it tries again on the next tick. Queries get a single try with a kTimeout
+ * reply timeout instead of the RoboClaw defaults (3 tries of 10ms), so a silent
+ * RoboClaw costs ~4.5ms rather than ~30ms, including draining any late reply. The results are cached with the time they
+ * were read, failed reads keep the last valid value.
+ */
+class Poller {
+  struct Reading {
+    uint32_t value = 0;
+    unsigned long time = 0;  // ms
+    bool valid = false;
+  };
+
+public:
+  // Loop ticks between queries, every value is refreshed every kPollTicks * NUM_QUERIES
+  static const uint8_t kPollTicks = 10;
+
+  // Reply timeout (us) per byte of a query, a reply byte takes ~0.26ms at 38400 baud
+  static const uint32_t kTimeout = 2000;
+
+  // Worst case (s) of a query round trip: 2 request and up to 6 reply bytes (~2.1ms)
+  // plus the RoboClaw response time, or if it does not answer the request, a kTimeout,
+  // then up to 6 late bytes and a quiet kTimeout while draining
+  static constexpr float kQueryTime = 0.008;
+
+  Poller(RoboClaw* roboclaw, const uint8_t& address): roboclaw_(roboclaw), address_(address) {}
+
+  // Poll if it is time and there is at least `spare` (s) left in the loop tick
+  void update(const float& spare);
+
+  // Check if a query has been answered at least once
+  inline bool has(const Query& query) const { return readings_[query].valid; }
+
+  // Time (ms) since a query was last answered
+  inline unsigned long age(const Query& query) const { return millis() - readings_[query].time; }
+
+  // Main battery voltage (V)
+  inline float supplyVoltage() const { return readings_[SUPPLY_VOLTAGE].value * 0.1; }
+
+  // Board temperature (C)
+  inline float temperature() const { return readings_[TEMPERATURE].value * 0.1; }
+
+  // Error and warning flags
+  inline const uint32_t& errorStatus() const { return readings_[ERROR_STATUS].value; }
+
+  // Print the cached values and their age
+  void print(Print& out) const;
+
+private:
+  RoboClaw* roboclaw_;
+  const uint8_t address_;
+  Reading readings_[NUM_QUERIES];
+  uint8_t ticks_ = 0;
+  uint8_t next_ = 0;
+
+  // Send a query and cache the result if valid
+  void poll(const Query& query);
+};
+
+
+}  // namespace telemetry
+
+
+#endif
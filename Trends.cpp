@@ -0,0 +1,222 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Trends.cpp
+ */
+
+#include "Trends.h"
+
+
+namespace trends {
+
+
+namespace {
+
+// Value represented by one code, per metric
+const float kStep[NUM_METRICS] = {
+  0.5,   // PEAK, up to 127 cmH2O
+  0.5,   // PLATEAU
+  0.5,   // PEEP
+  4.0,   // VOLUME, up to 1016 mL
+  0.25,  // RATE, up to 63.5 bpm
+  1.0    // ALARMS
+};
+
+// Interval lengths (ms)
+const unsigned long kMinute = 60000UL;
+const unsigned long kQuarterHour = 15 * kMinute;
+
+// Metric labels for the CSV header
+const char* const kLabels[NUM_METRICS] = {"Peak", "Plateau", "PEEP", "Volume", "RR", "Alarms"};
+
+}  // namespace
+
+
+/// Ring ///
+
+template <typename Row, uint8_t kLength>
+void Ring<Row, kLength>::push(const Row& row) {
+  rows_[head_] = row;
+  head_ = (head_ + 1) % kLength;
+  if (count_ < kLength) {
+    count_++;
+  }
+}
+
+
+/// Accumulator ///
+
+void Accumulator::add(const BreathRow& row) {
+  for (int i = 0; i < NUM_METRICS; i++) {
+    min_[i] = min(min_[i], row.value[i]);
+    max_[i] = max(max_[i], row.value[i]);
+    sum_[i] += row.value[i];
+  }
+  count_++;
+}
+
+ConsolidatedRow Accumulator::consolidate() const {
+  ConsolidatedRow row;
+  for (int i = 0; i < NUM_METRICS; i++) {
+    if (count_ == 0) {
+      row.min[i] = row.max[i] = row.avg[i] = TrendStore::kNoData;
+    }
+    else {
+      row.min[i] = min_[i];
+      row.max[i] = max_[i];
+      row.avg[i] = (sum_[i] + count_ / 2) / count_;
+    }
+  }
+  return row;
+}
+
+void Accumulator::reset() {
+  for (int i = 0; i < NUM_METRICS; i++) {
+    min_[i] = 255;
+    max_[i] = 0;
+    sum_[i] = 0;
+  }
+  count_ = 0;
+}
+
+
+/// TrendStore ///
+
+void TrendStore::begin() {
+  minute_start_ = quarter_hour_start_ = millis();
+}
+
+void TrendStore::update() {
+  // Intervals advance by their length so they do not drift with the loop period
+  const unsigned long now_ms = millis();
+  if (now_ms - minute_start_ >= kMinute) {
+    minutes_.push(minute_acc_.consolidate());
+    minute_acc_.reset();
+    minute_start_ += kMinute;
+  }
+  if (now_ms - quarter_hour_start_ >= kQuarterHour) {
+    quarter_hours_.push(quarter_hour_acc_.consolidate());
+    quarter_hour_acc_.reset();
+    quarter_hour_start_ += kQuarterHour;
+  }
+}
+
+void TrendStore::record(const float& peak, const float& plateau, const float& peep,
+                        const float& volume, const float& rate, const int& alarms) {
+  BreathRow row;
+  row.value[PEAK] = encode(PEAK, peak);
+  row.value[PLATEAU] = encode(PLATEAU, plateau);
+  row.value[PEEP] = encode(PEEP, peep);
+  row.value[VOLUME] = encode(VOLUME, volume);
+  row.value[RATE] = encode(RATE, rate);
+  row.value[ALARMS] = encode(ALARMS, alarms);
+  breaths_.push(row);
+  minute_acc_.add(row);
+  quarter_hour_acc_.add(row);
+}
+
+uint8_t TrendStore::size(const Resolution& resolution) const {
+  switch (resolution) {
+    case BREATH: return breaths_.size();
+    case MINUTE: return minutes_.size();
+    case QUARTER_HOUR: return quarter_hours_.size();
+    default: return 0;
+  }
+}
+
+bool TrendStore::printPage(Print& out, const Resolution& resolution, const uint8_t& page) const {
+  const uint8_t rows = size(resolution);
+
+  // Header, one metric per page
+  if (page < NUM_METRICS) {
+    if (page == 0) {
+      out.print("Age");
+    }
+    if (resolution == BREATH) {
+      out.print(',');
+      out.print(kLabels[page]);
+    }
+    else {
+      out.print(",Min"); out.print(kLabels[page]);
+      out.print(",Max"); out.print(kLabels[page]);
+      out.print(",Avg"); out.print(kLabels[page]);
+    }
+    if (page == NUM_METRICS - 1) {
+      out.println();
+      return rows > 0;
+    }
+    return true;
+  }
+
+  // Rows, the age is in breaths, minutes or quarter hours
+  const uint8_t age = page - NUM_METRICS;
+  if (age >= rows) {
+    return false;
+  }
+  out.print(age);
+  switch (resolution) {
+    case BREATH:
+      for (int i = 0; i < NUM_METRICS; i++) {
+        out.print(',');
+        out.print(decode((Metric)i, breaths_.recent(age).value[i]), 1);
+      }
+      break;
+    case MINUTE:
+      printRow(out, minutes_.recent(age));
+      break;
+    case QUARTER_HOUR:
+      printRow(out, quarter_hours_.recent(age));
+      break;
+    default:
+      break;
+  }
+  out.println();
+  return age + 1 < rows;
+}
+
+uint8_t TrendStore::encode(const Metric& metric, const float& value) {
+  const long code = lround(value / kStep[metric]);
+  return constrain(code, 0, kNoData - 1);
+}
+
+float TrendStore::decode(const Metric& metric, const uint8_t& code) {
+  return code == kNoData ? NAN : code * kStep[metric];
+}
+
+void TrendStore::printRow(Print& out, const ConsolidatedRow& row) {
+  for (int i = 0; i < NUM_METRICS; i++) {
+    out.print(',');
+    out.print(decode((Metric)i, row.min[i]), 1);
+    out.print(',');
+    out.print(decode((Metric)i, row.max[i]), 1);
+    out.print(',');
+    out.print(decode((Metric)i, row.avg[i]), 1);
+  }
+}
+
+
+}  // namespace trends
@@ -0,0 +1,183 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Trends.h
+ * Fixed-memory trend history of the breath measurements at several resolutions,
+ * in the style of a round-robin database.
+ */
+
+#ifndef Trends_h
+#define Trends_h
+
+#include "Arduino.h"
+
+
+namespace trends {
+
+
+// Trended measurements
+enum Metric {
+  PEAK,     // Peak pressure (cmH2O)
+  PLATEAU,  // Plateau pressure (cmH2O)
+  PEEP,     // PEEP (cmH2O)
+  VOLUME,   // Delivered volume (mL)
+  RATE,     // Actual respiratory rate (bpm)
+  ALARMS,   // Number of alarms on
+  NUM_METRICS
+};
+
+// Archive resolutions
+enum Resolution {
+  BREATH,        // Every breath
+  MINUTE,        // Consolidated over 1 minute
+  QUARTER_HOUR,  // Consolidated over 15 minutes
+  NUM_RESOLUTIONS
+};
+
+
+/**
+ * Ring
+ * Fixed-length ring of rows that overwrites the oldest row when full.
+ */
+template <typename Row, uint8_t kLength>
+class Ring {
+public:
+  // Add a row, overwriting the oldest one if full
+  void push(const Row& row);
+
+  // Number of rows stored
+  inline uint8_t size() const { return count_; }
+
+  // Get a row by age, 0 being the newest
+  inline const Row& recent(const uint8_t& age) const {
+    return rows_[(head_ + kLength - 1 - age) % kLength];
+  }
+
+private:
+  Row rows_[kLength];
+  uint8_t head_ = 0;
+  uint8_t count_ = 0;
+};
+
+
+// Encoded values of all metrics for one breath
+struct BreathRow {
+  uint8_t value[NUM_METRICS];
+};
+
+// Encoded min, max and average of all metrics over one interval
+struct ConsolidatedRow {
+  uint8_t min[NUM_METRICS];
+  uint8_t max[NUM_METRICS];
+  uint8_t avg[NUM_METRICS];
+};
+
+
+/**
+ * Accumulator
+ * Running min, max and sum of the breaths in the interval being consolidated.
+ */
+class Accumulator {
+public:
+  Accumulator() { reset(); }
+
+  // Add the encoded values of a breath
+  void add(const BreathRow& row);
+
+  // Consolidate the breaths added so far, rows without breaths hold no data
+  ConsolidatedRow consolidate() const;
+
+  // Start a new interval
+  void reset();
+
+private:
+  uint8_t min_[NUM_METRICS];
+  uint8_t max_[NUM_METRICS];
+  uint32_t sum_[NUM_METRICS];
+  uint16_t count_;
+};
+
+
+/**
+ * TrendStore
+ * Keeps the last breaths, minutes and quarter hours of every metric. Values are
+ * encoded in one byte each with a fixed resolution per metric, so the whole store
+ * takes under 800 bytes. Each breath is added to the breath ring and to the
+ * accumulator of each coarser resolution, which is consolidated into its ring
+ * when its interval elapses, so no step ever rescans the history.
+ */
+class TrendStore {
+public:
+  // Ring lengths: 30 breaths, 15 minutes and 4 hours
+  static const uint8_t kBreathLength = 30;
+  static const uint8_t kMinuteLength = 15;
+  static const uint8_t kQuarterHourLength = 16;
+
+  // Code of a missing value
+  static const uint8_t kNoData = 255;
+
+  // Setup during arduino setup()
+  void begin();
+
+  // Update during arduino loop(), consolidates the intervals that elapsed
+  void update();
+
+  // Record the measurements of a completed breath
+  void record(const float& peak, const float& plateau, const float& peep,
+              const float& volume, const float& rate, const int& alarms);
+
+  // Number of rows stored at a resolution
+  uint8_t size(const Resolution& resolution) const;
+
+  // Print a page of the stored rows of a resolution as CSV, newest first. The
+  // header takes one page per metric, then each row is a page. Returns false if
+  // it was the last page.
+  bool printPage(Print& out, const Resolution& resolution, const uint8_t& page) const;
+
+  // Convert between values and codes
+  static uint8_t encode(const Metric& metric, const float& value);
+  static float decode(const Metric& metric, const uint8_t& code);
+
+private:
+  Ring<BreathRow, kBreathLength> breaths_;
+  Ring<ConsolidatedRow, kMinuteLength> minutes_;
+  Ring<ConsolidatedRow, kQuarterHourLength> quarter_hours_;
+
+  Accumulator minute_acc_;
+  Accumulator quarter_hour_acc_;
+  unsigned long minute_start_ = 0;
+  unsigned long quarter_hour_start_ = 0;
+
+  // Print the min, max and average columns of a consolidated row
+  static void printRow(Print& out, const ConsolidatedRow& row);
+};
+
+
+}  // namespace trends
+
+
+#endif
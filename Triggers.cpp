@@ -0,0 +1,204 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Triggers.cpp
+ */
+
+#include "Triggers.h"
+
+#include <util/atomic.h>
+
+#include "Pressure.h"
+#include "Sampling.h"
+
+
+namespace triggers {
+
+
+namespace {
+
+const char* const kNames[] = {"Effort", "Trigger", "DoubleTrigger", "AutoTrigger", "Apnea"};
+
+}  // namespace
+
+
+/// TriggerMonitor ///
+
+void TriggerMonitor::begin() {
+  apnea_samples_ = apnea_time_ * sampling::AdcSampler::kPressureRate;
+}
+
+void TriggerMonitor::setPhase(const Phase& phase) {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (phase == IDLE) {
+      // Apnea is only timed while ventilating
+      apnea_ = false;
+      in_effort_ = false;
+      pending_ = false;
+      below_ = 0;
+    }
+    else if (phase_ == IDLE) {
+      last_effort_ = sample_;
+    }
+    if (phase == INSPIRATION && phase_ != INSPIRATION) {
+      last_triggered_ = false;  // At the start of a breath, until onTrigger() says otherwise
+    }
+    phase_ = phase;
+  }
+}
+
+void TriggerMonitor::setThreshold(const float& peep, const float& sensitivity) {
+  const uint16_t onset = Pressure::toRaw(peep - sensitivity);
+  const uint16_t release = Pressure::toRaw(peep - sensitivity / 2);
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (sensitivity > 0 && !enabled_) {
+      last_effort_ = sample_;
+    }
+    enabled_ = sensitivity > 0;
+    if (!enabled_) {
+      apnea_ = false;
+    }
+    onset_raw_ = onset;
+    release_raw_ = release;
+  }
+}
+
+void TriggerMonitor::update(const uint16_t& raw) {
+  sample_++;
+  if (!enabled_ || phase_ == IDLE) {
+    return;
+  }
+
+  // Efforts, with hysteresis so noise around the threshold is one effort
+  if (raw < onset_raw_) {
+    if (below_ < kMinEffortSamples) {
+      below_++;
+      if (below_ == kMinEffortSamples) {
+        in_effort_ = true;
+        last_effort_ = sample_;
+        apnea_ = false;
+        addEvent(EFFORT);
+        if (phase_ == REFRACTORY && last_triggered_) {
+          double_trigger_ = true;
+          addEvent(DOUBLE_TRIGGER);
+        }
+      }
+    }
+  }
+  else if (raw > release_raw_) {
+    below_ = 0;
+    in_effort_ = false;
+  }
+
+  // Judge a triggered breath once its dip is long enough, or over
+  if (pending_) {
+    if (below_ >= kMinTriggerSamples) {
+      pending_ = false;
+      addEvent(TRIGGER);
+    }
+    else if (below_ == 0) {
+      pending_ = false;
+      auto_trigger_ = true;
+      addEvent(AUTO_TRIGGER);
+    }
+  }
+
+  // Apnea, flagged once per interval without efforts
+  if (!apnea_ && sample_ - last_effort_ > apnea_samples_) {
+    apnea_ = true;
+    addEvent(APNEA);
+  }
+}
+
+void TriggerMonitor::onTrigger() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    last_triggered_ = true;
+    if (below_ >= kMinTriggerSamples) {
+      addEvent(TRIGGER);
+    }
+    else {
+      pending_ = true;
+    }
+  }
+}
+
+bool TriggerMonitor::consumeDoubleTrigger() {
+  bool double_trigger;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    double_trigger = double_trigger_;
+    double_trigger_ = false;
+  }
+  return double_trigger;
+}
+
+bool TriggerMonitor::consumeAutoTrigger() {
+  bool auto_trigger;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    auto_trigger = auto_trigger_;
+    auto_trigger_ = false;
+  }
+  return auto_trigger;
+}
+
+Event TriggerMonitor::event(const uint8_t& age) const {
+  Event event;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    event = events_[(head_ + kHistory - 1 - age) % kHistory];
+  }
+  return event;
+}
+
+bool TriggerMonitor::printPage(Print& out, const uint8_t& page) const {
+  if (page == 0) {
+    out.println("Age(s),Event");
+    return num_events_ > 0;
+  }
+  const uint8_t age = page - 1;
+  if (age >= num_events_) {
+    return false;
+  }
+  uint32_t now;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    now = sample_;
+  }
+  const Event e = event(age);
+  out.print((float)(now - e.sample) / sampling::AdcSampler::kPressureRate, 2);
+  out.print(',');
+  out.println(kNames[e.type]);
+  return age + 1 < num_events_;
+}
+
+void TriggerMonitor::addEvent(const EventType& type) {
+  events_[head_] = Event{type, sample_};
+  head_ = (head_ + 1) % kHistory;
+  if (num_events_ < kHistory) {
+    num_events_++;
+  }
+}
+
+
+}  // namespace triggers
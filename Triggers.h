@@ -0,0 +1,159 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Triggers.h
+ * Tracks patient efforts and triggered breaths on the raw pressure samples.
+ */
+
+#ifndef Triggers_h
+#define Triggers_h
+
+#include "Arduino.h"
+
+
+namespace triggers {
+
+
+// Breath events, in the order they can be told apart
+enum EventType : uint8_t {
+  EFFORT,          // Patient effort, pressure held below the trigger threshold
+  TRIGGER,         // Breath triggered on a patient effort
+  DOUBLE_TRIGGER,  // Patient effort during the refractory window of a triggered breath
+  AUTO_TRIGGER,    // Breath triggered on a pressure dip too short to be an effort
+  APNEA            // No patient effort for the apnea time
+};
+
+// Part of the breath cycle, set by the state machine
+enum Phase : uint8_t {
+  IDLE,         // Not ventilating
+  INSPIRATION,  // Inhale and inspiratory hold
+  REFRACTORY,   // Exhale and PEEP pause, triggers are not accepted
+  WINDOW        // Expiratory hold, triggers are accepted
+};
+
+// An event and the pressure sample count at which it happened
+struct Event {
+  EventType type;
+  uint32_t sample;
+};
+
+
+/**
+ * TriggerMonitor
+ * Runs on every pressure sample in the sampling interrupt with constant work: a
+ * count of consecutive samples below the trigger threshold (an effort once it
+ * lasts kMinEffortSamples) and the samples since the last effort. The state
+ * machine sets the phase and reports the breaths it triggers. Efforts in the
+ * refractory window after a triggered breath are double triggers, and no effort
+ * for the apnea time is apnea. The state machine triggers on a single sample
+ * below the threshold, so a triggered breath is only judged once its pressure
+ * dip ends: a dip shorter than kMinTriggerSamples is noise or a leak, an auto
+ * trigger. A patient keeps pulling while the motor starts to push. The last
+ * events are kept with their sample count as a timeline.
+ */
+class TriggerMonitor {
+public:
+  // Number of events kept
+  static const uint8_t kHistory = 8;
+
+  // Samples below the threshold for an effort, 40 ms at 500 Hz
+  static const uint8_t kMinEffortSamples = 20;
+
+  // Samples below the threshold for a triggered breath not to be an auto trigger, 10 ms
+  static const uint8_t kMinTriggerSamples = 5;
+
+  // Apnea time in s
+  explicit TriggerMonitor(const float& apnea_time): apnea_time_(apnea_time) {}
+
+  // Setup during arduino setup()
+  void begin();
+
+  // Set the phase on state transitions
+  void setPhase(const Phase& phase);
+
+  // Set the trigger threshold from the PEEP and the trigger sensitivity (cmH2O),
+  // a non-positive sensitivity disables monitoring (no assist control)
+  void setThreshold(const float& peep, const float& sensitivity);
+
+  // Process a raw pressure sample, only to be called from the sampling interrupt
+  void update(const uint16_t& raw);
+
+  // Report a breath triggered by the patient, it is classified once its dip ends
+  void onTrigger();
+
+  // Check if a double trigger happened since last called, and clear it
+  bool consumeDoubleTrigger();
+
+  // Check if an auto trigger happened since last called, and clear it
+  bool consumeAutoTrigger();
+
+  // Check if there has been no effort for the apnea time
+  inline bool apnea() const { return apnea_; }
+
+  // Number of events in the timeline
+  inline uint8_t numEvents() const { return num_events_; }
+
+  // Get an event by age, 0 being the newest
+  Event event(const uint8_t& age) const;
+
+  // Print the timeline, the header (page 0) or one event (page 1 on), newest
+  // first. Returns false if it was the last page.
+  bool printPage(Print& out, const uint8_t& page) const;
+
+private:
+  const float apnea_time_;
+  uint32_t apnea_samples_ = 0;
+
+  // Hysteresis thresholds, an effort starts below onset and ends above release
+  volatile uint16_t onset_raw_ = 0;
+  volatile uint16_t release_raw_ = 0;
+  volatile bool enabled_ = false;
+  volatile Phase phase_ = IDLE;
+  volatile bool last_triggered_ = false;  // The last breath was triggered by the patient
+  volatile bool pending_ = false;         // Triggered breath waiting for its dip to end
+
+  volatile uint32_t sample_ = 0;
+  volatile uint32_t last_effort_ = 0;
+  uint8_t below_ = 0;
+  volatile bool in_effort_ = false;
+  volatile bool apnea_ = false;
+  volatile bool double_trigger_ = false;
+  volatile bool auto_trigger_ = false;
+
+  Event events_[kHistory];
+  volatile uint8_t head_ = 0;
+  volatile uint8_t num_events_ = 0;
+
+  // Add an event at the current sample, with interrupts disabled
+  void addEvent(const EventType& type);
+};
+
+
+}  // namespace triggers
+
+
+#endif
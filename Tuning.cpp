@@ -0,0 +1,154 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Tuning.cpp
+ */
+
+#include "Tuning.h"
+
+
+namespace tuning {
+
+
+/// RelayTuner ///
+
+bool RelayTuner::run(const long& center, const long& span, const int16_t& duty,
+                     void (*keep_alive)()) {
+  const unsigned long start = millis();
+  bool started = false;
+  bool up = false;        // Relay output
+  bool centered = false;  // Crossed the center going up
+  bool reached = false;   // Crossed the center either way
+  long limit = 0;         // Furthest allowed from the center (clicks)
+  uint8_t cycles = 0;
+  long high = center, low = center;
+  unsigned long cycle_start = 0;
+  uint32_t period_sum = 0;  // ms
+  uint32_t swing_sum = 0;   // clicks peak to peak
+
+  bool ok = false;
+  while (millis() - start < kTimeout) {
+    keep_alive();
+    // Not getting to the center, e.g. stalled, checked whether or not the reads succeed
+    if (started && !reached && millis() - start > kApproachTime) {
+      break;
+    }
+    bool valid;
+    const long pos = (int32_t)roboclaw_->ReadEncM1(address_, NULL, &valid);
+    if (!valid) {
+      // Never drive blind, the guards below need the position
+      if (started) {
+        break;
+      }
+      continue;
+    }
+    if (!started) {
+      // Drive towards the center first
+      up = pos < center;
+      roboclaw_->DutyM1(address_, up ? duty : -duty);
+      started = true;
+      limit = abs(pos - center) + kMargin;
+      continue;
+    }
+    // Moving away from the center, e.g. a reversed motor or encoder
+    if (abs(pos - center) > limit) {
+      break;
+    }
+    high = max(high, pos);
+    low = min(low, pos);
+
+    if (up && pos > center + kHysteresis) {
+      up = false;
+      roboclaw_->DutyM1(address_, -duty);
+      centered = true;
+      reached = true;
+      limit = span;
+    }
+    else if (!up && pos < center - kHysteresis) {
+      // A cycle ends at each switch to +duty
+      up = true;
+      roboclaw_->DutyM1(address_, duty);
+      reached = true;
+      limit = span;
+      const unsigned long now_ms = millis();
+      if (centered && ++cycles > kSkipCycles) {
+        period_sum += now_ms - cycle_start;
+        swing_sum += high - low;
+      }
+      if (cycles == kSkipCycles + kCycles) {
+        ok = true;
+        break;
+      }
+      cycle_start = now_ms;
+      high = low = pos;
+    }
+  }
+  roboclaw_->DutyM1(address_, 0);
+  if (!ok) {
+    return false;
+  }
+
+  amplitude_ = 0.5 * swing_sum / kCycles;
+  if (amplitude_ <= kHysteresis) {
+    return false;
+  }
+  tu_ = 1e-3 * period_sum / kCycles;
+  ku_ = 4 * duty / (PI * sqrt(sq(amplitude_) - sq(kHysteresis)));
+  return true;
+}
+
+bool RelayTuner::plausible(const Gains& gains, const Gains& reference, const float& range) {
+  // Written so that NaN fails
+  return gains.kp >= reference.kp / range && gains.kp <= reference.kp * range &&
+         gains.ki >= reference.ki / range && gains.ki <= reference.ki * range &&
+         gains.kd >= reference.kd / range && gains.kd <= reference.kd * range;
+}
+
+Gains RelayTuner::positionGains() const {
+  // No overshoot rule: Kp = 0.2 Ku, Ti = Tu / 2, Td = Tu / 3
+  const float kp = 0.2 * ku_;
+  return Gains{kp, kp / (0.5 * tu_ * kControllerRate), kp * tu_ / 3 * kControllerRate};
+}
+
+void RelayTuner::print(Print& out) const {
+  const Gains gains = positionGains();
+  out.print("Ku=");
+  out.print(ku_, 3);
+  out.print(" Tu(s)=");
+  out.print(tu_, 3);
+  out.print(" A(clicks)=");
+  out.println(amplitude_, 1);
+  out.print("Kp=");
+  out.print(gains.kp, 3);
+  out.print(" Ki=");
+  out.print(gains.ki, 4);
+  out.print(" Kd=");
+  out.println(gains.kd, 3);
+}
+
+
+}  // namespace tuning
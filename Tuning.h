@@ -0,0 +1,120 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Tuning.h
+ * Relay auto-tuning of the RoboClaw position PID.
+ */
+
+#ifndef Tuning_h
+#define Tuning_h
+
+#include "Arduino.h"
+#include "src/thirdparty/RoboClaw/RoboClaw.h"
+
+
+namespace tuning {
+
+
+// PID gains in RoboClaw units
+struct Gains {
+  float kp;
+  float ki;
+  float kd;
+};
+
+
+/**
+ * RelayTuner
+ * Drives the motor with a relay, +duty below the center position and -duty above
+ * it, which makes it oscillate at the ultimate period Tu of the position loop.
+ * The encoder is read as fast as the serial link allows. From the amplitude a of
+ * the oscillation the ultimate gain is Ku = 4 * duty / (pi * sqrt(a^2 - h^2)),
+ * where h is the hysteresis of the relay. The gains follow the Ziegler-Nichols
+ * rule without overshoot, since the arm pushes a bag. The motor must be homed and
+ * the bag removed. Blocks for at most kTimeout.
+ *
+ * The test stops the motor if the arm moves kMargin further from the center than
+ * where it started, as with a reversed motor or encoder, if it does not reach the
+ * center within kApproachTime, as when stalled, or once oscillating if it leaves
+ * the span around the center. Any failed encoder read while driving also stops it,
+ * since none of these guards can run without the position.
+ */
+class RelayTuner {
+public:
+  // Oscillation cycles to let settle, then to measure
+  static const uint8_t kSkipCycles = 2;
+  static const uint8_t kCycles = 6;
+
+  // Relay hysteresis (clicks) around the center, rejects encoder noise
+  static const int kHysteresis = 2;
+
+  // Give up after this time (ms)
+  static const unsigned long kTimeout = 5000;
+
+  // Abort if the arm does not reach the center within this time (ms)
+  static const unsigned long kApproachTime = 1500;
+
+  // Abort if the arm moves this far (clicks) beyond its start distance from the center
+  static const long kMargin = 20;
+
+  // Update rate (Hz) of the RoboClaw position loop, the time base of Ki and Kd
+  static constexpr float kControllerRate = 300.0;
+
+  RelayTuner(RoboClaw* roboclaw, const uint8_t& address): roboclaw_(roboclaw), address_(address) {}
+
+  // Run the relay test around center (clicks) with the given duty (0-32767). Aborts if
+  // the motor goes further than span from the center once it has reached it.
+  // keep_alive is called at every sample. Returns whether the test completed.
+  bool run(const long& center, const long& span, const int16_t& duty, void (*keep_alive)());
+
+  // Results of the last completed test
+  inline const float& ultimateGain() const { return ku_; }      // Duty per click
+  inline const float& ultimatePeriod() const { return tu_; }    // s
+  inline const float& amplitude() const { return amplitude_; }  // clicks
+
+  // Position PID gains from the last completed test
+  Gains positionGains() const;
+
+  // Check if all gains are within a factor of range of the reference gains
+  static bool plausible(const Gains& gains, const Gains& reference, const float& range);
+
+  // Print the results of the last completed test
+  void print(Print& out) const;
+
+private:
+  RoboClaw* roboclaw_;
+  const uint8_t address_;
+  float ku_ = 0.0;
+  float tu_ = 0.0;
+  float amplitude_ = 0.0;
+};
+
+
+}  // namespace tuning
+
+
+#endif
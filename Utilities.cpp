@@ -30,6 +30,8 @@
 
 #include "Utilities.h"
 
+#include "Sampling.h"
+
 
 namespace utils {
 
@@ -39,10 +41,62 @@ namespace utils {
 Pulse::Pulse(const unsigned long& period, const float& duty, const bool& random_offset):
     period_(period),
     on_duration_(duty * period),
-    offset_(random_offset ? random(period) : 0) {}
+    phase_(random_offset ? random(period) : 0),
+    next_(animationClock.head_) {
+  animationClock.head_ = this;
+}
 
-bool Pulse::read() {
-  return (millis() - offset_) % period_ < on_duration_;
+void Pulse::advance(const unsigned long& dt) {
+  if (dt >= period_) {
+    // Only after a long stall, e.g. the first update after setup
+    cycles_ += dt / period_;
+    phase_ += dt % period_;
+  }
+  else {
+    phase_ += dt;
+  }
+  if (phase_ >= period_) {
+    phase_ -= period_;
+    cycles_++;
+  }
+}
+
+
+/// AnimationClock ///
+
+AnimationClock animationClock;
+
+void AnimationClock::update() {
+  const unsigned long time = millis();
+  const unsigned long dt = time - time_;
+  time_ = time;
+  for (Pulse* pulse = head_; pulse != nullptr; pulse = pulse->next_) {
+    pulse->advance(dt);
+  }
+}
+
+/// MotionTracker ///
+
+void MotionTracker::start(const float& dur) {
+  end_time_ = millis() + (unsigned long)(dur * 1000);
+  active_ = true;
+  done_ = false;
+}
+
+bool MotionTracker::update(const RoboClaw& roboclaw) {
+  if (!active_) {
+    return false;
+  }
+  if (done_) {
+    return true;
+  }
+  // Poll only once the move may end before the next loop tick
+  if ((long)(millis() + (unsigned long)(LOOP_PERIOD * 1000) - end_time_) < 0) {
+    return false;
+  }
+  uint8_t depth1, depth2;
+  done_ = roboclaw.ReadBuffers(ROBOCLAW_ADDR, depth1, depth2) && depth1 == kBufferEmpty;
+  return done_;
 }
 
 float map(float x, float in_min, float in_max, float out_min, float out_max) {
@@ -58,25 +112,28 @@ float volume2ticks(const float& vol_ml) {
 }
 
 float readVolume() {
-  return map(analogRead(VOL_PIN), 0, ANALOG_PIN_MAX, VOL_MIN, VOL_MAX);
+  return map(sampling::sampler.latest(VOL_PIN), 0, ANALOG_PIN_MAX, VOL_MIN, VOL_MAX);
 }
 
 float readBpm() {
-  return map(analogRead(BPM_PIN), 0, ANALOG_PIN_MAX, BPM_MIN, BPM_MAX);
+  return map(sampling::sampler.latest(BPM_PIN), 0, ANALOG_PIN_MAX, BPM_MIN, BPM_MAX);
 }
 
 float readIeRatio() {
-  return map(analogRead(IE_PIN), 0, ANALOG_PIN_MAX, IE_MIN, IE_MAX);
+  return map(sampling::sampler.latest(IE_PIN), 0, ANALOG_PIN_MAX, IE_MIN, IE_MAX);
 }
 
 float readAc() {
-  return map(analogRead(AC_PIN), 0, ANALOG_PIN_MAX, AC_MIN - AC_RES, AC_MAX);
+  return map(sampling::sampler.latest(AC_PIN), 0, ANALOG_PIN_MAX, AC_MIN - AC_RES, AC_MAX);
 }
 
 bool readEncoder(const RoboClaw& roboclaw, int& motorPosition) {
   uint8_t robot_status;
   bool valid;
-  motorPosition = roboclaw.ReadEncM1(ROBOCLAW_ADDR, &robot_status, &valid);
+  const uint32_t position = roboclaw.ReadEncM1(ROBOCLAW_ADDR, &robot_status, &valid);
+  if (valid) {
+    motorPosition = position;
+  }
   return valid;
 }
 
@@ -84,12 +141,22 @@ void goToPosition(const RoboClaw& roboclaw, const long& pos, const long& vel, co
     roboclaw.SpeedAccelDeccelPositionM1(ROBOCLAW_ADDR, acc, vel, acc, pos, 1); 
 }
 
-void goToPositionByDur(const RoboClaw& roboclaw, const long& goal_pos, const long& cur_pos, const float& dur) {
-  if (dur <= 0) return; // Can't move in negative time
+bool goToPositionByDur(const RoboClaw& roboclaw, const long& goal_pos, const long& cur_pos, const float& dur) {
+  long vel, acc;
+  if (!planPositionByDur(goal_pos, cur_pos, dur, vel, acc)) {
+    return false;
+  }
+  goToPosition(roboclaw, goal_pos, vel, acc);
+  return true;
+}
+
+bool planPositionByDur(const long& goal_pos, const long& cur_pos, const float& dur,
+                       long& vel, long& acc) {
+  if (dur <= 0) return false; // Can't move in negative time
 
   const long dist = abs(goal_pos - cur_pos);
-  long vel = round(2*dist/dur); // Try bang-bang control
-  long acc = round(2*vel/dur); // Constant acc in and out
+  vel = round(2*dist/dur); // Try bang-bang control
+  acc = round(2*vel/dur); // Constant acc in and out
   if (vel > VEL_MAX) {
     // Must use trapezoidal velocity profile to clip at VEL_MAX
     vel = VEL_MAX;
@@ -97,8 +164,33 @@ void goToPositionByDur(const RoboClaw& roboclaw, const long& goal_pos, const lon
     acc = acc_dur > 0 ? round(vel/acc_dur) : ACC_MAX;
     acc = min(ACC_MAX, acc);
   }
+  return true;
+}
+
+void preparePosition(MotionCommand& cmd, const long& pos, const long& vel, const long& acc) {
+  cmd.length = RoboClaw::EncodeSpeedAccelDeccelPositionM1(cmd.packet, ROBOCLAW_ADDR,
+                                                          acc, vel, acc, pos, 1);
+}
+
+void preparePositionByDur(MotionCommand& cmd, const long& goal_pos, const long& cur_pos,
+                          const float& dur) {
+  if (cmd.ready() && cmd.goal_pos == goal_pos && cmd.cur_pos == cur_pos && cmd.dur == dur) {
+    return;
+  }
+  long vel, acc;
+  if (planPositionByDur(goal_pos, cur_pos, dur, vel, acc)) {
+    preparePosition(cmd, goal_pos, vel, acc);
+    cmd.goal_pos = goal_pos;
+    cmd.cur_pos = cur_pos;
+    cmd.dur = dur;
+  }
+  else {
+    cmd.reset();
+  }
+}
 
-  goToPosition(roboclaw, goal_pos, vel, acc);
+bool sendCommand(const RoboClaw& roboclaw, const MotionCommand& cmd) {
+  return cmd.ready() && roboclaw.WritePacket(cmd.packet, cmd.length);
 }
 
 bool readMotorCurrent(const RoboClaw& roboclaw, int& motorCurrent) {
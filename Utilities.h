@@ -45,19 +45,112 @@ namespace utils {
 
 /**
  * Pulse
- * Generates an ON/OFF signal with given period and duty.
+ * Generates an ON/OFF signal with given period and duty. Its phase is advanced by
+ * `animationClock`, so reading it costs nothing.
  */
 class Pulse {
+  friend class AnimationClock;
+
 public:
   Pulse(const unsigned long& period, const float& duty, const bool& random_offset = true);
 
+  // Registered with the clock by address, so it cannot be copied
+  Pulse(const Pulse&) = delete;
+
   // Read current ON/OFF value
-  bool read();
+  inline bool read() const { return phase_ < on_duration_; }
+
+  // Number of whole periods elapsed, wrapping around
+  inline const uint16_t& cycles() const { return cycles_; }
+
+private:
+  const uint16_t period_;
+  const uint16_t on_duration_;
+  uint16_t phase_;
+  uint16_t cycles_ = 0;
+  Pulse* next_;
+
+  // Advance the phase by dt milliseconds
+  void advance(const unsigned long& dt);
+};
+
+
+/**
+ * AnimationClock
+ * Advances the phase of every Pulse once per loop, replacing a 32-bit modulo of
+ * millis() in each of them with a subtraction when a period wraps around.
+ */
+class AnimationClock {
+  friend class Pulse;
+
+public:
+  constexpr AnimationClock(): head_(nullptr), time_(0) {}
+
+  // Advance all pulses to the current time, during arduino loop()
+  void update();
+
+private:
+  Pulse* head_;  // Pulses register themselves on construction
+  unsigned long time_;
+};
+
+// The clock of all pulses
+extern AnimationClock animationClock;
+
+
+/**
+ * MotionCommand
+ * A position command planned and encoded ahead of time, so that it can be sent
+ * without any math at the moment it is needed.
+ */
+struct MotionCommand {
+  // Length of a SpeedAccelDeccelPositionM1 packet including CRC
+  static const uint8_t kMaxLength = 21;
+
+  uint8_t packet[kMaxLength];
+  uint8_t length = 0;
+
+  // Inputs it was planned for, to skip replanning if nothing changed
+  long goal_pos = 0;
+  long cur_pos = 0;
+  float dur = 0;
+
+  // Check if there is a command to send
+  inline bool ready() const { return length > 0; }
+
+  // Discard the command, e.g. once sent
+  inline void reset() { length = 0; }
+};
+
+
+/**
+ * MotionTracker
+ * Detects the end of a position move from the RoboClaw buffer status, which reads
+ * empty once the last command has finished. The buffer is only queried from one
+ * loop period before the planned end of the move, so it costs no round trips
+ * while the motor is still moving.
+ */
+class MotionTracker {
+public:
+  // Buffer depth reported when the buffer is empty and the last command finished
+  static const uint8_t kBufferEmpty = 0x80;
+
+  // Start tracking a move planned to take dur seconds from now
+  void start(const float& dur);
+
+  // Stop tracking, e.g. if the move was not sent
+  inline void reset() {
+    active_ = false;
+    done_ = false;
+  }
+
+  // Check if the tracked move has finished, querying the RoboClaw if it may have
+  bool update(const RoboClaw& roboclaw);
 
 private:
-  const unsigned long period_;
-  const unsigned long on_duration_;
-  const unsigned long offset_;
+  unsigned long end_time_ = 0;  // Planned end of the move (ms)
+  bool active_ = false;
+  bool done_ = false;
 };
 
 
@@ -83,14 +176,30 @@ float readIeRatio();      // Reads set IE ratio from the IE pot
 float readAc();           // Reads set AC mode trigger sensitivity from the AC pot
 
 /// Motor ///
-// Read the encoder and return whether the reading is valid
+// Read the encoder and return whether the reading is valid, keeping the last position if not
 bool readEncoder(const RoboClaw& roboclaw, int& motorPosition);
 
 // Go to a desired position at the given speed
 void goToPosition(const RoboClaw& roboclaw, const long& pos, const long& vel, const long& acc);
 
-// Go to a desired position over the specified duration
-void goToPositionByDur(const RoboClaw& roboclaw, const long& goal_pos, const long& cur_pos, const float& dur);
+// Go to a desired position over the specified duration, returns false if that is not possible
+bool goToPositionByDur(const RoboClaw& roboclaw, const long& goal_pos, const long& cur_pos, const float& dur);
+
+// Compute the speed and acceleration to go to a position over the specified duration,
+// returns false if that is not possible
+bool planPositionByDur(const long& goal_pos, const long& cur_pos, const float& dur,
+                       long& vel, long& acc);
+
+// Encode a command to go to a desired position at the given speed
+void preparePosition(MotionCommand& cmd, const long& pos, const long& vel, const long& acc);
+
+// Encode a command to go to a desired position over the specified duration,
+// unless it is already prepared for the same inputs
+void preparePositionByDur(MotionCommand& cmd, const long& goal_pos, const long& cur_pos,
+                          const float& dur);
+
+// Send a prepared command and return whether it was acknowledged
+bool sendCommand(const RoboClaw& roboclaw, const MotionCommand& cmd);
 
 // Read the motor current and return whether the reading is valid
 bool readMotorCurrent(const RoboClaw& roboclaw, int& motorCurrent);
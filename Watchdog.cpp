@@ -0,0 +1,137 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Watchdog.cpp
+ */
+
+#include "Watchdog.h"
+
+#include <avr/wdt.h>
+
+
+namespace watchdog {
+
+
+namespace {
+
+// Watchdog timeout, longer than the blocking pauses in setup and homing
+const uint8_t kTimeout = WDTO_2S;
+
+const char* const kNames[NUM_TASKS] = {"Motor", "Pressure", "Alarms", "Display", "Logger"};
+
+// Reset cause saved before static init, in .noinit as .bss is only zeroed after .init3
+uint8_t resetFlags __attribute__((section(".noinit")));
+
+}  // namespace
+
+
+// Runs from .init3, before static constructors, so MCUSR is read before anything
+// else can clear it, and a watchdog left enabled by a reset cannot fire again
+// during a slow static init
+void saveResetFlags() __attribute__((naked, used, section(".init3")));
+void saveResetFlags() {
+  resetFlags = MCUSR;
+  MCUSR = 0;
+  wdt_disable();
+}
+
+
+/// Supervisor ///
+
+Supervisor::Supervisor() {
+  //                           deadline (ms), critical
+  tasks_[MOTOR]    = TaskStats{200, true,  0, 0, 0};
+  tasks_[PRESSURE] = TaskStats{100, true,  0, 0, 0};
+  tasks_[ALARMS]   = TaskStats{100, true,  0, 0, 0};
+  tasks_[DISPLAY]  = TaskStats{500, false, 0, 0, 0};
+  tasks_[LOGGER]   = TaskStats{500, false, 0, 0, 0};
+}
+
+void Supervisor::begin() {
+  watchdog_reset_ = resetFlags & (1 << WDRF);
+}
+
+void Supervisor::start() {
+  const unsigned long now_ms = millis();
+  for (int i = 0; i < NUM_TASKS; i++) {
+    tasks_[i].last = now_ms;
+  }
+  started_ = true;
+  wdt_enable(kTimeout);
+}
+
+void Supervisor::checkIn(const Task& task) {
+  const unsigned long now_ms = millis();
+  TaskStats& stats = tasks_[task];
+  if (started_) {
+    const unsigned long gap = now_ms - stats.last;
+    stats.max_gap = max(stats.max_gap, gap);
+    if (gap > stats.deadline) {
+      stats.misses++;
+    }
+  }
+  stats.last = now_ms;
+}
+
+void Supervisor::kick() {
+  const unsigned long now_ms = millis();
+  for (int i = 0; i < NUM_TASKS; i++) {
+    if (tasks_[i].critical && now_ms - tasks_[i].last > tasks_[i].deadline) {
+      return;
+    }
+  }
+  wdt_reset();
+}
+
+void Supervisor::hold() {
+  const unsigned long now_ms = millis();
+  for (int i = 0; i < NUM_TASKS; i++) {
+    tasks_[i].last = now_ms;
+  }
+  wdt_reset();
+}
+
+bool Supervisor::printPage(Print& out, const uint8_t& page) const {
+  if (page == 0) {
+    out.println("Task,Deadline(ms),MaxGap(ms),Misses,Critical");
+    return true;
+  }
+  const uint8_t i = page - 1;
+  out.print(kNames[i]);
+  out.print(',');
+  out.print(tasks_[i].deadline);
+  out.print(',');
+  out.print(tasks_[i].max_gap);
+  out.print(',');
+  out.print(tasks_[i].misses);
+  out.print(',');
+  out.println(tasks_[i].critical ? 1 : 0);
+  return page < NUM_TASKS;
+}
+
+
+}  // namespace watchdog
@@ -0,0 +1,106 @@
+/**
+ * MIT Emergency Ventilator Controller
+ * 
+ * MIT License:
+ * 
+ * Copyright (c) 2020 MIT
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Watchdog.h
+ * Kicks the hardware watchdog only while the critical tasks of the loop keep
+ * checking in, and records how close each task came to its deadline.
+ */
+
+#ifndef Watchdog_h
+#define Watchdog_h
+
+#include "Arduino.h"
+
+
+namespace watchdog {
+
+
+// Supervised tasks
+enum Task {
+  MOTOR,     // Encoder and current reads, motion commands
+  PRESSURE,  // New pressure samples arriving
+  ALARMS,    // Alarm evaluation and beeper
+  DISPLAY,   // LCD updates
+  LOGGER,    // Serial/SD logging
+  NUM_TASKS
+};
+
+
+/**
+ * Supervisor
+ * Each task checks in once per loop. The watchdog is kicked at the end of the loop
+ * only if every critical task checked in within its deadline, otherwise it resets
+ * the board after kTimeout. A hung RoboClaw retry loop or SD write blocks the loop
+ * entirely and trips it the same way. For every task the longest gap between check
+ * ins and the number of missed deadlines are kept.
+ */
+class Supervisor {
+  struct TaskStats {
+    unsigned long deadline;  // ms
+    bool critical;
+    unsigned long last;      // ms
+    unsigned long max_gap;   // ms
+    unsigned int misses;
+  };
+
+public:
+  Supervisor();
+
+  // Get the reset cause, saved and cleared before static init, during arduino setup()
+  void begin();
+
+  // Enable the watchdog, at the end of arduino setup()
+  void start();
+
+  // Record that a task ran
+  void checkIn(const Task& task);
+
+  // Kick the watchdog if all critical tasks are on time, at the end of arduino loop()
+  void kick();
+
+  // Kick the watchdog from a deliberate blocking routine that stops the loop, e.g.
+  // auto-tuning. The time it takes does not count against any task.
+  void hold();
+
+  // Check if the last reset was caused by the watchdog
+  inline bool watchdogReset() const { return watchdog_reset_; }
+
+  // Print the deadline statistics of every task, the header (page 0) or the row
+  // of one task (page 1 on). Returns false if it was the last page.
+  bool printPage(Print& out, const uint8_t& page) const;
+
+private:
+  TaskStats tasks_[NUM_TASKS];
+  bool watchdog_reset_ = false;
+  bool started_ = false;
+};
+
+
+}  // namespace watchdog
+
+
+#endif
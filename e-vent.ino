@@ -29,17 +29,31 @@
  * Main Arduino file.
  */
 
-#include "LiquidCrystal.h"
 #include "src/thirdparty/RoboClaw/RoboClaw.h"
 #include "cpp_utils.h"  // Redefines macros min, max, abs, etc. into proper functions,
                         // should be included after third-party code, before E-Vent includes
 #include "Alarms.h"
 #include "Buttons.h"
+#include "Calibration.h"
 #include "Constants.h"
+#include "Control.h"
 #include "Display.h"
 #include "Input.h"
+#include "Lcd.h"
 #include "Logging.h"
+#include "Mechanics.h"
+#include "Metrics.h"
+#include "Power.h"
 #include "Pressure.h"
+#include "Safety.h"
+#include "Sampling.h"
+#include "Shell.h"
+#include "Storage.h"
+#include "Telemetry.h"
+#include "Trends.h"
+#include "Triggers.h"
+#include "Tuning.h"
+#include "Watchdog.h"
 
 
 using namespace input;
@@ -69,16 +83,52 @@ float tStateTimer;
 // Roboclaw
 RoboClaw roboclaw(&Serial3, 10000);
 int motorCurrent, motorPosition = 0;
+telemetry::Poller telemetryPoller(&roboclaw, ROBOCLAW_ADDR);
+tuning::RelayTuner positionTuner(&roboclaw, ROBOCLAW_ADDR);
+const tuning::Gains defaultPositionGains = {PKP, PKI, PKD};
+tuning::Gains positionGains = defaultPositionGains;  // Replaced by auto-tuned gains once stored
 
 // LCD Screen
-LiquidCrystal lcd(LCD_RS_PIN, LCD_EN_PIN, LCD_D4_PIN, dLCD_D5_PIN, LCD_D6_PIN, LCD_D7_PIN);
-display::Display displ(&lcd, AC_MIN);
+display::Lcd lcd(LCD_RS_PIN, LCD_EN_PIN, LCD_D4_PIN, dLCD_D5_PIN, LCD_D6_PIN, LCD_D7_PIN);
+display::Display displ(&lcd, AC_MIN, PRESSURE_GRAPH);
 
 // Alarms
 alarms::AlarmManager alarm(BEEPER_PIN, SNOOZE_PIN, LED_ALARM_PIN, &displ, &cycleCount);
 
 // Pressure
-Pressure pressureReader(PRESS_SENSE_PIN);
+Pressure pressureReader(&sampling::sampler);
+calibration::ZeroTracker zeroTracker(&sampling::sampler);
+safety::OverpressureCutoff overpressureCutoff(&roboclaw, MAX_PRESSURE);
+
+// Measured ventilation
+metrics::BreathMetrics breathMetrics;
+float tInActual;  // Actual inspiratory time (s) of the last breath
+
+// Patient efforts and triggers
+triggers::TriggerMonitor triggerMonitor(APNEA_TIME);
+
+// Task supervision
+watchdog::Supervisor supervisor;
+
+// Settings and counters kept across resets
+storage::RecordStore settingsStore;
+
+// Serial commands
+shell::Shell serialShell(&Serial);
+
+// Time awake per state
+power::DutyCycle dutyCycle;
+
+// Trend history
+trends::TrendStore trendStore;
+trends::Resolution trendResolution = trends::BREATH;  // Being printed by the shell
+float tidalVolume;  // Volume (mL) delivered in the last inspiration
+
+// Pressure control
+control::PressureController pressureController(&roboclaw, PC_KP, PC_KI, VEL_MAX);
+
+// Respiratory mechanics
+mechanics::Estimator mechanicsEstimator;
 
 // Buttons
 buttons::PressHoldButton offButton(OFF_PIN, 2000);
@@ -93,16 +143,26 @@ struct Knobs {
   int bpm();     // Respiratory rate
   float ie();    // Inhale/exhale ratio
   float ac();    // Assist control trigger sensitivity
-  SafeKnob<int> volume_ = SafeKnob<int>(&displ, display::VOLUME, CONFIRM_PIN, &alarm, VOL_RES);
-  SafeKnob<int> bpm_ = SafeKnob<int>(&displ, display::BPM, CONFIRM_PIN, &alarm, BPM_RES);
-  SafeKnob<float> ie_ = SafeKnob<float>(&displ, display::IE_RATIO, CONFIRM_PIN, &alarm, IE_RES);
-  SafeKnob<float> ac_ = SafeKnob<float>(&displ, display::AC_TRIGGER, CONFIRM_PIN, &alarm, AC_RES);
+  SafeKnob<int> volume_{&displ, display::VOLUME, CONFIRM_PIN, &alarm, VOL_RES};
+  SafeKnob<int> bpm_{&displ, display::BPM, CONFIRM_PIN, &alarm, BPM_RES};
+  SafeKnob<float> ie_{&displ, display::IE_RATIO, CONFIRM_PIN, &alarm, IE_RES};
+  SafeKnob<float> ac_{&displ, display::AC_TRIGGER, CONFIRM_PIN, &alarm, AC_RES};
   void begin();
   void update();
+  void restore(const storage::RecordStore& store);
 } knobs;
 
 // Assist control
 bool patientTriggered = false;
+bool breathTriggered = false;  // Whether the breath in progress was patient triggered
+
+// End of the move that clears the bag during exhalation
+MotionTracker exhaleMotion;
+
+// Next breath, prepared during the expiratory pause to be sent with minimal latency
+MotionCommand nextBreath;
+bool breathStarted = false;
+long volumeLimit;  // Position (clicks) not to exceed in pressure control
 
 
 ///////////////////////
@@ -115,20 +175,70 @@ void setState(States newState);
 // Calculates the waveform parameters from the user inputs
 void calculateWaveform();
 
+// Plan and encode the inhale command of the next breath
+void prepareNextBreath();
+
+// Send the prepared inhale command and restart the cycle timer
+void startBreath();
+
+// In pressure control, stop the loop once the volume limit is reached. The RoboClaw
+// already stops the arm there, this hands the motor back to the control loop.
+void checkVolumeLimit();
+
 // Check for errors and take appropriate action
 void handleErrors();
 
 // Set up logger variables
 void setupLogger();
 
+// Queue changed settings and counters for storage and write them in the background
+void saveSettings();
+
+// Send position PID gains to the RoboClaw
+void setPositionPID(const tuning::Gains& gains);
+
+// Register the serial commands
+void setupShell();
+
+// Check in the pressure task if new samples arrived since the last loop
+void checkInSampling();
+
+// Handle each raw pressure sample in the sampling interrupt
+void onPressureSample(const uint16_t& raw);
+
 
 ///////////////////
 ////// Setup //////
 ///////////////////
 
 void setup() {
+  supervisor.begin();
   Serial.begin(SERIAL_BAUD_RATE);
   while(!Serial);
+  if (supervisor.watchdogReset()) {
+    Serial.println("Restarted by the watchdog");
+  }
+
+  // Restore what was saved before the reset, settings are restored after knobs.begin()
+  settingsStore.begin();
+  cycleCount = settingsStore.get(storage::TOTAL_BREATHS);
+  alarm.setTriggerCount(settingsStore.get(storage::ALARM_COUNT));
+  if (settingsStore.has(storage::POSITION_KP)) {
+    const tuning::Gains stored = {settingsStore.getFloat(storage::POSITION_KP),
+                                  settingsStore.getFloat(storage::POSITION_KI),
+                                  settingsStore.getFloat(storage::POSITION_KD)};
+    if (tuning::RelayTuner::plausible(stored, defaultPositionGains, TUNE_GAIN_RANGE)) {
+      positionGains = stored;
+    }
+  }
+  if (settingsStore.has(storage::PRESSURE_ZERO)) {
+    calibration::zero_q4 = settingsStore.get(storage::PRESSURE_ZERO);  // Until captured again
+  }
+
+  // Start sampling pressure and knobs in the background
+  const int knobPins[] = {VOL_PIN, BPM_PIN, IE_PIN, AC_PIN};
+  sampling::sampler.setPressureCallback(&onPressureSample);
+  sampling::sampler.begin(PRESS_SENSE_PIN, knobPins, sizeof(knobPins) / sizeof(knobPins[0]));
 
   if (DEBUG) {
     setState(DEBUG_STATE);
@@ -136,24 +246,35 @@ void setup() {
     setState(PREHOME_STATE);  // Initial state
   }
 
-  // Wait for the roboclaw to boot up
-  delay(1000);
+  // Wait for the roboclaw to boot up, capturing the pressure zero before anything moves
+  zeroTracker.capture();
+  const unsigned long tBoot = millis();
+  while (millis() - tBoot < 1000) {
+    zeroTracker.update(true);
+    delay(20);
+  }
   
   //Initialize
   pinMode(HOME_PIN, INPUT_PULLUP);  // Pull up the limit switch
   setupLogger();
+  setupShell();
   alarm.begin();
   displ.begin();
+  trendStore.begin();
+  triggerMonitor.begin();
   offButton.begin();
   confirmButton.begin();
   knobs.begin();
+  knobs.restore(settingsStore);
   tCycleTimer = now();
 
   roboclaw.begin(ROBOCLAW_BAUD);
   roboclaw.SetM1MaxCurrent(ROBOCLAW_ADDR, ROBOCLAW_MAX_CURRENT);
   roboclaw.SetM1VelocityPID(ROBOCLAW_ADDR, VKP, VKI, VKD, QPPS);
-  roboclaw.SetM1PositionPID(ROBOCLAW_ADDR, PKP, PKI, PKD, KI_MAX, DEADZONE, MIN_POS, MAX_POS);
+  setPositionPID(positionGains);
   roboclaw.SetEncM1(ROBOCLAW_ADDR, 0);  // Zero the encoder
+  overpressureCutoff.begin(BAG_CLEAR_POS, VEL_MAX, ACC_MAX);
+  supervisor.start();
 }
 
 //////////////////
@@ -161,29 +282,35 @@ void setup() {
 //////////////////
 
 void loop() {
-  if (DEBUG) {
-    if (Serial.available() > 0) {
-      setState((States) Serial.parseInt());
-      while(Serial.available() > 0) Serial.read();
-    }
-  }
+  serialShell.update();
 
   // All States
   tLoopTimer = now();  // Start the loop timer
+  dutyCycle.beginTick(state);
+  utils::animationClock.update();
   logger.update();
+  supervisor.checkIn(watchdog::LOGGER);
   knobs.update();
   calculateWaveform();
   readEncoder(roboclaw, motorPosition);  // TODO handle invalid reading
   readMotorCurrent(roboclaw, motorCurrent);
+  supervisor.checkIn(watchdog::MOTOR);  // Returned, a failed read still counts as on time
+  zeroTracker.update(state == OFF_STATE);  // Nothing pushes the bag while off
+  checkInSampling();
   pressureReader.read();
   handleErrors();
   alarm.update();
+  supervisor.checkIn(watchdog::ALARMS);
+  displ.addPressure(pressureReader.recentMax());
   displ.update();
+  supervisor.checkIn(watchdog::DISPLAY);
+  trendStore.update();
+  saveSettings();
   offButton.update();
 
   if (offButton.wasHeld()) {
+    setState(OFF_STATE);  // First, so the pressure loop cannot override the retract
     goToPositionByDur(roboclaw, BAG_CLEAR_POS, motorPosition, MAX_EX_DURATION);
-    setState(OFF_STATE);
     alarm.allOff();
   }
   
@@ -206,12 +333,14 @@ void loop() {
     case IN_STATE:
       if (enteringState) {
         enteringState = false;
-        const float tNow = now();
-        tPeriodActual = tNow - tCycleTimer;
-        tCycleTimer = tNow;  // The cycle begins at the start of inspiration
-        goToPositionByDur(roboclaw, volume2ticks(knobs.volume()), motorPosition, tIn);
-        cycleCount++;
+        if (!breathStarted) {
+          startBreath();  // Not started on the transition, e.g. first breath after homing
+          breathTriggered = false;
+        }
+        breathStarted = false;
       }
+      mechanicsEstimator.addSample(ticks2volume(motorPosition), pressureReader.get(), tLoopTimer);
+      checkVolumeLimit();
 
       if (now() - tCycleTimer > tIn) {
         setState(HOLD_IN_STATE);
@@ -221,7 +350,10 @@ void loop() {
     case HOLD_IN_STATE:
       if (enteringState) {
         enteringState = false;
+        pressureReader.start_plateau_window();
       }
+      mechanicsEstimator.addSample(ticks2volume(motorPosition), pressureReader.get(), tLoopTimer);
+      checkVolumeLimit();
       if (now() - tCycleTimer > tHoldIn) {
         pressureReader.set_plateau();
         setState(EX_STATE);
@@ -231,10 +363,20 @@ void loop() {
     case EX_STATE:
       if (enteringState) {
         enteringState = false;
-        goToPositionByDur(roboclaw, BAG_CLEAR_POS, motorPosition, tEx - (now() - tCycleTimer));
+        mechanicsEstimator.endBreath();
+        tidalVolume = ticks2volume(motorPosition);
+        tInActual = now() - tCycleTimer;
+        const float tExMove = tEx - (now() - tCycleTimer);
+        if (goToPositionByDur(roboclaw, BAG_CLEAR_POS, motorPosition, tExMove)) {
+          exhaleMotion.start(tExMove);
+        }
+        else {
+          exhaleMotion.reset();
+        }
       }
 
-      if (abs(motorPosition - BAG_CLEAR_POS) < BAG_CLEAR_TOL) {
+      // The RoboClaw reports the end of the move without waiting for the encoder
+      if (exhaleMotion.update(roboclaw) || abs(motorPosition - BAG_CLEAR_POS) < BAG_CLEAR_TOL) {
         setState(PEEP_PAUSE_STATE);
       }
       break;
@@ -242,7 +384,9 @@ void loop() {
     case PEEP_PAUSE_STATE:
       if (enteringState) {
         enteringState = false;
+        pressureReader.start_peep_window();
       }
+      prepareNextBreath();
       
       if (now() - tCycleTimer > tEx + MIN_PEEP_PAUSE) {
         pressureReader.set_peep();
@@ -254,19 +398,29 @@ void loop() {
     case HOLD_EX_STATE:
       if (enteringState) {
         enteringState = false;
+        triggerMonitor.setThreshold(pressureReader.peep(), knobs.ac() > AC_MIN ? knobs.ac() : 0);
       }
+      prepareNextBreath();
 
       // Check if patient triggers inhale
       patientTriggered = pressureReader.get() < (pressureReader.peep() - knobs.ac()) 
           && knobs.ac() > AC_MIN;
 
       if (patientTriggered || now() - tCycleTimer > tPeriod) {
+        startBreath();  // Send right away, bookkeeping below is not time critical
         if (!patientTriggered) pressureReader.set_peep();  // Set peep again if time triggered
         pressureReader.set_peak_and_reset();
         displ.writePeakP(round(pressureReader.peak()));
         displ.writePEEP(round(pressureReader.peep()));
         displ.writePlateauP(round(pressureReader.plateau()));
+        // The breath that just ended, the trigger decided now belongs to the next one
+        breathMetrics.addBreath(tPeriodActual, tInActual, tidalVolume, breathTriggered);
+        breathTriggered = patientTriggered;
+        displ.writeMeasured(round(breathMetrics.tidalVolume()), round(breathMetrics.rate()));
+        trendStore.record(pressureReader.peak(), pressureReader.plateau(), pressureReader.peep(),
+                          tidalVolume, 60 / tPeriodActual, alarm.numON());
         setState(IN_STATE);
+        if (patientTriggered) triggerMonitor.onTrigger();
       }
       break;
 
@@ -289,16 +443,21 @@ void loop() {
       
       if (!homeSwitchPressed()) {
         roboclaw.ForwardM1(ROBOCLAW_ADDR, 0);
+        supervisor.hold();
         delay(HOMING_PAUSE * 1000);  // Wait for things to settle
+        supervisor.hold();  // The pause does not count against any task
         roboclaw.SetEncM1(ROBOCLAW_ADDR, 0);  // Zero the encoder
         setState(IN_STATE);
       }
       break;
   }
 
-  // Add a delay if there's still time in the loop period
+  // Slow telemetry fills spare time, then sleep if there's still time in the loop period
+  telemetryPoller.update(tLoopTimer + LOOP_PERIOD - now());
   tLoopBuffer = max(0, tLoopTimer + LOOP_PERIOD - now());
-  delay(tLoopBuffer*1000.0);
+  dutyCycle.endWork();
+  supervisor.kick();
+  power::idle(tLoopBuffer * 1e6);
 }
 
 
@@ -313,6 +472,21 @@ void Knobs::begin() {
   ac_.begin(&readAc);
 }
 
+void Knobs::restore(const storage::RecordStore& store) {
+  if (store.has(storage::VOLUME_SETTING)) {
+    volume_.restore(constrain((int32_t)store.get(storage::VOLUME_SETTING), VOL_MIN, VOL_MAX));
+  }
+  if (store.has(storage::BPM_SETTING)) {
+    bpm_.restore(constrain((int32_t)store.get(storage::BPM_SETTING), BPM_MIN, BPM_MAX));
+  }
+  if (store.has(storage::IE_SETTING)) {
+    ie_.restore(constrain(store.getFloat(storage::IE_SETTING), IE_MIN, IE_MAX));
+  }
+  if (store.has(storage::AC_SETTING)) {
+    ac_.restore(constrain(store.getFloat(storage::AC_SETTING), AC_MIN - AC_RES, AC_MAX));
+  }
+}
+
 void Knobs::update() {
   volume_.update();
   bpm_.update();
@@ -329,6 +503,53 @@ void setState(States newState) {
   enteringState = true;
   state = newState;
   tStateTimer = now();
+
+  // A breath started on the transition only stands for the IN_STATE right after it
+  if (newState != IN_STATE) {
+    breathStarted = false;
+  }
+
+  // Pressure is tracked through the inspiratory hold, any other state commands the motor
+  if (newState != IN_STATE && newState != HOLD_IN_STATE) {
+    pressureController.stop();
+  }
+
+  // The fast retract is a position command, so only watch once homed
+  switch (newState) {
+    case IN_STATE:
+      overpressureCutoff.arm();
+      break;
+    case DEBUG_STATE:
+    case OFF_STATE:
+    case PREHOME_STATE:
+    case HOMING_STATE:
+      overpressureCutoff.disarm();
+      break;
+  }
+
+  // Efforts count as double triggers in the refractory window, and as triggers in the window
+  switch (newState) {
+    case IN_STATE:
+    case HOLD_IN_STATE:
+      triggerMonitor.setPhase(triggers::INSPIRATION);
+      break;
+    case EX_STATE:
+    case PEEP_PAUSE_STATE:
+      triggerMonitor.setPhase(triggers::REFRACTORY);
+      break;
+    case HOLD_EX_STATE:
+      triggerMonitor.setPhase(triggers::WINDOW);
+      break;
+    default:
+      triggerMonitor.setPhase(triggers::IDLE);
+      break;
+  }
+
+  // Measurements do not carry over a stop
+  if (newState == OFF_STATE) {
+    breathMetrics.reset();
+    displ.writeMeasured(-1, -1);
+  }
 }
 
 void calculateWaveform() {
@@ -338,24 +559,79 @@ void calculateWaveform() {
   tEx = min(tHoldIn + MAX_EX_DURATION, tPeriod - MIN_PEEP_PAUSE);
 }
 
+void prepareNextBreath() {
+  static int volume = -1;
+  static long goalPos;
+  if (knobs.volume() != volume) {
+    volume = knobs.volume();
+    goalPos = volume2ticks(volume);
+  }
+  preparePositionByDur(nextBreath, goalPos, motorPosition, tIn);
+}
+
+void startBreath() {
+  if (!nextBreath.ready()) {
+    prepareNextBreath();
+  }
+  const float tNow = now();
+  tPeriodActual = tNow - tCycleTimer;
+  tCycleTimer = tNow;  // The cycle begins at the start of inspiration
+  if (PRESSURE_CONTROL) {
+    volumeLimit = volume2ticks(knobs.volume());
+    pressureController.start(PC_PRESSURE, volumeLimit);
+  }
+  else {
+    sendCommand(roboclaw, nextBreath);
+  }
+  nextBreath.reset();
+  mechanicsEstimator.beginBreath(ticks2volume(motorPosition), tNow);
+  breathStarted = true;
+  cycleCount++;
+  logger.markBreath(cycleCount);
+}
+
+void checkVolumeLimit() {
+  if (pressureController.active() && motorPosition >= volumeLimit) {
+    pressureController.stop();
+    roboclaw.SpeedM1(ROBOCLAW_ADDR, 0);
+  }
+}
+
 void handleErrors() {
-  // Pressure alarms
-  const bool over_pressure = pressureReader.get() >= MAX_PRESSURE;
+  // Pressure alarms, the cutoff may already have retracted from the sampling interrupt
+  const bool over_pressure = overpressureCutoff.consumeTrip() || pressureReader.get() >= MAX_PRESSURE;
   alarm.highPressure(over_pressure);
   if (over_pressure) setState(EX_STATE);
 
   // These pressure alarms only make sense after homing 
   if (enteringState && state == IN_STATE) {
-    alarm.badPlateau(pressureReader.peak() - pressureReader.plateau() > MAX_RESIST_PRESSURE);
+    // Resistance estimate does not depend on the flow, fall back to peak - plateau without it
+    alarm.badPlateau(mechanicsEstimator.valid() ?
+        mechanicsEstimator.resistance() > MAX_RESISTANCE :
+        pressureReader.peak() - pressureReader.plateau() > MAX_RESIST_PRESSURE);
     alarm.lowPressure(pressureReader.plateau() < MIN_PLATEAU_PRESSURE);
     alarm.noTidalPres(pressureReader.peak() - pressureReader.peep() < MIN_TIDAL_PRESSURE);
+    alarm.doubleTrigger(triggerMonitor.consumeDoubleTrigger());
+    alarm.autoTrigger(triggerMonitor.consumeAutoTrigger());
+    alarm.lowMinuteVentilation(breathMetrics.valid() && breathMetrics.minuteVentilation() <
+        MIN_VENTILATION_FRACTION * knobs.volume() * knobs.bpm() / 1000);
   }
 
-  // Check if desired volume was reached
-  if (enteringState && state == EX_STATE) {
+  // Check if desired volume was reached, in pressure control the volume is only a limit
+  if (enteringState && state == EX_STATE && !PRESSURE_CONTROL) {
     alarm.unmetVolume(knobs.volume() - ticks2volume(motorPosition) > VOLUME_ERROR_THRESH);
   }
 
+  // Apnea is timed on the pressure samples, so check it every loop
+  alarm.apnea(triggerMonitor.apnea());
+
+  // Motor driver status, once polled
+  alarm.lowSupplyVoltage(telemetryPoller.has(telemetry::SUPPLY_VOLTAGE) &&
+                         telemetryPoller.supplyVoltage() < MIN_SUPPLY_VOLTAGE);
+  alarm.driverOverheat(telemetryPoller.has(telemetry::TEMPERATURE) &&
+                       telemetryPoller.temperature() > MAX_DRIVER_TEMP);
+  alarm.driverError((telemetryPoller.errorStatus() & ROBOCLAW_ERROR_MASK) != 0);
+
   // Check if maximum motor current was exceeded
   if (motorCurrent >= MAX_MOTOR_CURRENT) {
     setState(EX_STATE);
@@ -368,17 +644,254 @@ void handleErrors() {
   alarm.mechanicalFailure(state == EX_STATE && now() - tCycleTimer > tPeriod + MECHANICAL_TIMEOUT);
 }
 
+void setPositionPID(const tuning::Gains& gains) {
+  roboclaw.SetM1PositionPID(ROBOCLAW_ADDR, gains.kp, gains.ki, gains.kd, KI_MAX, DEADZONE,
+                            MIN_POS, MAX_POS);
+}
+
+void saveSettings() {
+  settingsStore.set(storage::VOLUME_SETTING, knobs.volume());
+  settingsStore.set(storage::BPM_SETTING, knobs.bpm());
+  settingsStore.setFloat(storage::IE_SETTING, knobs.ie());
+  settingsStore.setFloat(storage::AC_SETTING, knobs.ac());
+  settingsStore.set(storage::ALARM_COUNT, alarm.triggerCount());
+
+  // Breaths in steps and the zero only once it moved half a count, to spare the EEPROM
+  if (cycleCount - settingsStore.get(storage::TOTAL_BREATHS) >= BREATH_SAVE_INTERVAL ||
+      (state == OFF_STATE && cycleCount != settingsStore.get(storage::TOTAL_BREATHS))) {
+    settingsStore.set(storage::TOTAL_BREATHS, cycleCount);
+  }
+  if (!settingsStore.has(storage::PRESSURE_ZERO) ||
+      abs(calibration::zero_q4 - (int16_t)settingsStore.get(storage::PRESSURE_ZERO)) >= 8) {
+    settingsStore.set(storage::PRESSURE_ZERO, (uint16_t)calibration::zero_q4);
+  }
+
+  settingsStore.update();
+}
+
+void checkInSampling() {
+  static uint8_t lastHead = 0;
+  const uint8_t head = sampling::sampler.head();
+  if (head != lastHead) {
+    lastHead = head;
+    supervisor.checkIn(watchdog::PRESSURE);
+  }
+}
+
+void onPressureSample(const uint16_t& raw) {
+  if (overpressureCutoff.check(raw)) {
+    pressureController.stop();
+  }
+  else {
+    pressureController.update(raw);
+  }
+  triggerMonitor.update(raw);
+}
+
 void setupLogger() {
-  logger.addVar("Time", &tLoopTimer);
-  logger.addVar("CycleStart", &tCycleTimer);
-  logger.addVar("State", (int*)&state);
-  logger.addVar("Pos", &motorPosition, 3);
-  logger.addVar("Pressure", &pressureReader.get(), 6);
-  // logger.addVar("Period", &tPeriodActual);
-  // logger.addVar("tLoopBuffer", &tLoopBuffer, 6, 4);
-  // logger.addVar("Current", &motorCurrent, 3);
-  // logger.addVar("Peep", &pressureReader.peep(), 6);
-  // logger.addVar("HighPresAlarm", &alarm.getHighPressure());
+  // All candidates are registered, the disabled ones can be enabled over serial
+  bool ok = true;
+  ok &= logger.addVar("Time", &tLoopTimer);
+  ok &= logger.addVar("CycleStart", &tCycleTimer);
+  ok &= logger.addVar("State", (int*)&state);
+  ok &= logger.addVar("Pos", &motorPosition, 3);
+  ok &= logger.addVar("Pressure", &pressureReader.get(), 6);
+  ok &= logger.addVar("Period", &tPeriodActual, 1, 2, false);
+  ok &= logger.addVar("tLoopBuffer", &tLoopBuffer, 6, 4, false);
+  ok &= logger.addVar("Current", &motorCurrent, 3, 2, false);
+  ok &= logger.addVar("Peep", &pressureReader.peep(), 6, 2, false);
+  ok &= logger.addVar("HighPresAlarm", &alarm.getHighPressure(), 1, 2, false);
+  ok &= logger.addVar("Compliance", &mechanicsEstimator.compliance(), 5, 1, false);
+  ok &= logger.addVar("Resistance", &mechanicsEstimator.resistance(), 5, 1, false);
+  ok &= logger.addVar("TimeConst", &mechanicsEstimator.timeConstant(), 4, 3, false);
+  ok &= logger.addVar("MeasRR", &breathMetrics.rate(), 4, 1, false);
+  ok &= logger.addVar("MeasIE", &breathMetrics.ieRatio(), 3, 1, false);
+  ok &= logger.addVar("MeasTV", &breathMetrics.tidalVolume(), 3, 0, false);
+  ok &= logger.addVar("MinuteVent", &breathMetrics.minuteVentilation(), 4, 1, false);
+  ok &= logger.addVar("Spontaneous", &breathMetrics.spontaneousFraction(), 4, 2, false);
+  if (!ok) {
+    Serial.println("logger: too many variables, raise Logger::kMaxVars");
+  }
   // begin called after all variables added to include them all in the header
   logger.begin(&Serial, SD_SELECT);
 }
+
+bool profPage(const uint8_t& page, Print& out) {
+  if (page <= NUM_STATES) {
+    dutyCycle.printPage(out, page);
+    return true;
+  }
+  if (page <= NUM_STATES + 1 + watchdog::NUM_TASKS) {
+    supervisor.printPage(out, page - NUM_STATES - 1);
+    return true;
+  }
+  overpressureCutoff.print(out);
+  return false;
+}
+
+bool logVarsPage(const uint8_t& page, Print& out) {
+  return logger.printVar(out, page);
+}
+
+bool triggerPage(const uint8_t& page, Print& out) {
+  return triggerMonitor.printPage(out, page);
+}
+
+bool trendPage(const uint8_t& page, Print& out) {
+  return trendStore.printPage(out, trendResolution, page);
+}
+
+void shellState(const uint8_t& argc, char* argv[], Print& out) {
+  if (argc > 1) {
+    const int newState = atoi(argv[1]);
+    if (!DEBUG) {  // The override bypasses the breath cycle
+      out.println("state override needs DEBUG");
+      return;
+    }
+    if (newState < 0 || newState >= NUM_STATES) {
+      out.println("bad state");
+      return;
+    }
+    setState((States)newState);
+  }
+  out.println(state);
+}
+
+void shellGet(const uint8_t& argc, char* argv[], Print& out) {
+  out.print("TV="); out.print(knobs.volume());
+  out.print(" RR="); out.print(knobs.bpm());
+  out.print(" IE=1:"); out.print(knobs.ie(), 1);
+  out.print(" AC="); out.println(knobs.ac(), 1);
+  out.print("peak="); out.print(pressureReader.peak(), 1);
+  out.print(" plat="); out.print(pressureReader.plateau(), 1);
+  out.print(" PEEP="); out.println(pressureReader.peep(), 1);
+  out.print("measTV="); out.print(breathMetrics.tidalVolume(), 0);
+  out.print(" measRR="); out.print(breathMetrics.rate(), 1);
+  out.print(" measIE=1:"); out.print(breathMetrics.ieRatio(), 1);
+  out.print(" MV="); out.println(breathMetrics.minuteVentilation(), 2);
+}
+
+void shellProf(const uint8_t& argc, char* argv[], Print& out) {
+  serialShell.page(&profPage);
+}
+
+void holdWatchdog() {
+  supervisor.hold();
+}
+
+void shellTune(const uint8_t& argc, char* argv[], Print& out) {
+  if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+    settingsStore.erase(storage::POSITION_KP);
+    settingsStore.erase(storage::POSITION_KI);
+    settingsStore.erase(storage::POSITION_KD);
+    positionGains = defaultPositionGains;
+    setPositionPID(positionGains);
+    out.println("position PID back to the constants");
+    return;
+  }
+  if (argc < 2 || strcmp(argv[1], "run") != 0) {
+    positionTuner.print(out);
+    out.println("tune run: oscillates the arm, only when off and with the bag removed");
+    return;
+  }
+  if (state != OFF_STATE) {
+    out.println("only when off");
+    return;
+  }
+  const bool done = positionTuner.run(TUNE_POS, TUNE_SPAN, TUNE_DUTY, &holdWatchdog);
+  if (done && !tuning::RelayTuner::plausible(positionTuner.positionGains(), defaultPositionGains,
+                                              TUNE_GAIN_RANGE)) {
+    positionTuner.print(out);
+    out.println("tuned gains out of range, gains unchanged");
+  }
+  else if (done) {
+    positionGains = positionTuner.positionGains();
+    setPositionPID(positionGains);
+    settingsStore.setFloat(storage::POSITION_KP, positionGains.kp);
+    settingsStore.setFloat(storage::POSITION_KI, positionGains.ki);
+    settingsStore.setFloat(storage::POSITION_KD, positionGains.kd);
+    positionTuner.print(out);
+  }
+  else {
+    out.println("tuning failed, gains unchanged");
+  }
+  readEncoder(roboclaw, motorPosition);
+  goToPositionByDur(roboclaw, BAG_CLEAR_POS, motorPosition, MAX_EX_DURATION);
+}
+
+void shellTele(const uint8_t& argc, char* argv[], Print& out) {
+  telemetryPoller.print(out);
+}
+
+void shellLog(const uint8_t& argc, char* argv[], Print& out) {
+  if (argc < 3) {
+    serialShell.page(&logVarsPage);
+    return;
+  }
+  const bool on = strcmp(argv[2], "on") == 0;
+  const bool off = strcmp(argv[2], "off") == 0;
+  if (strcmp(argv[1], "serial") == 0) {
+    logger.enableSerial(on);
+  }
+  else if (strcmp(argv[1], "sd") == 0) {
+    logger.enableSD(on);
+  }
+  else if (on || off) {
+    if (!logger.enableVar(argv[1], on)) out.println("unknown variable");
+  }
+  else if (atoi(argv[2]) < 1 || atoi(argv[2]) > 255) {
+    out.println("usage: log serial|sd|<var> on|off, log <var> <n>");
+  }
+  else if (!logger.setDecimation(argv[1], atoi(argv[2]))) {
+    out.println("unknown variable");
+  }
+}
+
+void shellTrig(const uint8_t& argc, char* argv[], Print& out) {
+  serialShell.page(&triggerPage);
+}
+
+void shellTrend(const uint8_t& argc, char* argv[], Print& out) {
+  const char res = argc > 1 ? argv[1][0] : 'b';
+  switch (res) {
+    case 'b': trendResolution = trends::BREATH; break;
+    case 'm': trendResolution = trends::MINUTE; break;
+    case 'q': trendResolution = trends::QUARTER_HOUR; break;
+    default:
+      out.println("usage: trend b|m|q");
+      return;
+  }
+  serialShell.page(&trendPage);
+}
+
+void shellFind(const uint8_t& argc, char* argv[], Print& out) {
+  if (argc < 3 || (argv[1][0] != 'b' && argv[1][0] != 't')) {
+    out.println("usage: find b <breath> | find t <seconds>");
+    return;
+  }
+  const unsigned long value = strtoul(argv[2], nullptr, 10);
+  const long offset = argv[1][0] == 'b' ? logger.findBreath(value) : logger.findTime(value * 1000);
+  if (offset < 0) {
+    out.println("not in the SD log index");
+    return;
+  }
+  out.print(offset);
+  out.print(": ");
+  logger.printLine(out, offset);
+}
+
+void setupShell() {
+  bool ok = true;
+  ok &= serialShell.addCommand("state", &shellState, "[n] print or, in DEBUG, override the state");
+  ok &= serialShell.addCommand("get", &shellGet, "print setpoints and measurements");
+  ok &= serialShell.addCommand("prof", &shellProf, "print duty cycle per state and task deadlines");
+  ok &= serialShell.addCommand("log", &shellLog, "[serial|sd|<var> on|off|<n>] list variables, pause a channel, toggle a variable or log it every n loops");
+  ok &= serialShell.addCommand("find", &shellFind, "b <breath>|t <seconds> print the SD log line where a breath starts");
+  ok &= serialShell.addCommand("tune", &shellTune, "[run|reset] print, run or undo the position PID auto-tuning");
+  ok &= serialShell.addCommand("tele", &shellTele, "print motor driver voltage, temperature and errors");
+  ok &= serialShell.addCommand("trig", &shellTrig, "print the last patient efforts and triggers");
+  ok &= serialShell.addCommand("trend", &shellTrend, "b|m|q print breath, minute or quarter-hour trends");
+  if (!ok) {
+    Serial.println("shell: too many commands, raise Shell::kMaxCommands");
+  }
+}
@@ -11,18 +11,32 @@
 RoboClaw::RoboClaw(HardwareSerial *serial, uint32_t tout)
 {
 	timeout = tout;
+	ack_timeout = tout;
+	retries = MAXRETRY;
 	hserial = serial;
 #ifdef __AVR__
 	sserial = 0;
 #endif
+	tx_busy = false;
+	urgent_acks = 0;
+	urgent_packet = 0;
+	urgent_len = 0;
+	urgent_sent_us = 0;
 }
 
 #ifdef __AVR__
 RoboClaw::RoboClaw(SoftwareSerial *serial, uint32_t tout)
 {
 	timeout = tout;
+	ack_timeout = tout;
+	retries = MAXRETRY;
 	sserial = serial;
 	hserial = 0;
+	tx_busy = false;
+	urgent_acks = 0;
+	urgent_packet = 0;
+	urgent_len = 0;
+	urgent_sent_us = 0;
 }
 #endif
 
@@ -182,10 +196,95 @@ uint16_t RoboClaw::crc_get()
 	return crc;
 }
 
+uint8_t RoboClaw::encode_n(uint8_t *packet,uint8_t cnt, ... )
+{
+	uint16_t pcrc = 0;
+	va_list marker;
+	va_start( marker, cnt );     /* Initialize variable arguments. */
+	for(uint8_t index=0;index<cnt;index++){
+		uint8_t data = va_arg(marker, int);
+		pcrc = pcrc ^ ((uint16_t)data << 8);
+		for (uint8_t i=0; i<8; i++)
+		{
+			if (pcrc & 0x8000)
+				pcrc = (pcrc << 1) ^ 0x1021;
+			else
+				pcrc <<= 1;
+		}
+		packet[index] = data;
+	}
+	va_end( marker );              /* Reset variable arguments.      */
+	packet[cnt] = pcrc>>8;
+	packet[cnt+1] = pcrc;
+	return cnt+2;
+}
+
+void RoboClaw::begin_tx()
+{
+	tx_busy = true;
+	// Replies must line up with requests, so drop the acks of injected packets first.
+	// The ISR defers while tx_busy is set, so urgent_acks cannot change here.
+	while(urgent_acks){
+		read(ack_timeout);
+		urgent_acks--;
+	}
+}
+
+void RoboClaw::end_tx()
+{
+	noInterrupts();
+	tx_busy = false;
+	if(urgent_len){
+		send_urgent(urgent_packet,urgent_len);
+		urgent_len = 0;
+	}
+	interrupts();
+}
+
+void RoboClaw::send_urgent(const uint8_t *packet,uint8_t len)
+{
+	for(uint8_t index=0;index<len;index++)
+		write(packet[index]);
+	urgent_acks++;
+	urgent_sent_us = micros();
+}
+
+bool RoboClaw::WritePacket(const uint8_t *packet,uint8_t len)
+{
+	uint8_t trys=retries;
+	do{
+		begin_tx();
+		for(uint8_t index=0;index<len;index++)
+			write(packet[index]);
+		end_tx();
+		if(read(timeout)==0xFF)
+			return true;
+	}while(trys--);
+	return false;
+}
+
+bool RoboClaw::WritePacketFromISR(const uint8_t *packet,uint8_t len)
+{
+	if(tx_busy){
+		urgent_packet = packet;
+		urgent_len = len;
+		return false;
+	}
+	send_urgent(packet,len);
+	return true;
+}
+
+void RoboClaw::CancelPacketFromISR(const uint8_t *packet)
+{
+	if(urgent_len && urgent_packet==packet)
+		urgent_len = 0;
+}
+
 bool RoboClaw::write_n(uint8_t cnt, ... )
 {
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	do{
+		begin_tx();
 		crc_clear();
 		//send data with crc
 		va_list marker;
@@ -199,6 +298,7 @@ bool RoboClaw::write_n(uint8_t cnt, ... )
 		uint16_t crc = crc_get();
 		write(crc>>8);
 		write(crc);
+		end_tx();
 		if(read(timeout)==0xFF)
 			return true;
 	}while(trys--);
@@ -208,17 +308,19 @@ bool RoboClaw::write_n(uint8_t cnt, ... )
 bool RoboClaw::read_n(uint8_t cnt,uint8_t address,uint8_t cmd,...)
 {
 	uint32_t value=0;
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	int16_t data;
 	do{
 		flush();
 		
 		data=0;
+		begin_tx();
 		crc_clear();
 		write(address);
 		crc_update(address);
 		write(cmd);
 		crc_update(cmd);
+		end_tx();
 
 		//send data with crc
 		va_list marker;
@@ -290,16 +392,18 @@ uint8_t RoboClaw::Read1(uint8_t address,uint8_t cmd,bool *valid){
 		*valid = false;
 	
 	uint8_t value=0;
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	int16_t data;
 	do{
 		flush();
 
+		begin_tx();
 		crc_clear();
 		write(address);
 		crc_update(address);
 		write(cmd);
 		crc_update(cmd);
+		end_tx();
 	
 		data = read(timeout);
 		crc_update(data);
@@ -333,16 +437,18 @@ uint16_t RoboClaw::Read2(uint8_t address,uint8_t cmd,bool *valid){
 		*valid = false;
 	
 	uint16_t value=0;
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	int16_t data;
 	do{
 		flush();
 
+		begin_tx();
 		crc_clear();
 		write(address);
 		crc_update(address);
 		write(cmd);
 		crc_update(cmd);
+		end_tx();
 	
 		data = read(timeout);
 		crc_update(data);
@@ -382,16 +488,18 @@ uint32_t RoboClaw::Read4(uint8_t address, uint8_t cmd, bool *valid){
 		*valid = false;
 	
 	uint32_t value=0;
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	int16_t data;
 	do{
 		flush();
 
+		begin_tx();
 		crc_clear();
 		write(address);
 		crc_update(address);
 		write(cmd);
 		crc_update(cmd);
+		end_tx();
 
 		data = read(timeout);
 		crc_update(data);
@@ -443,16 +551,18 @@ uint32_t RoboClaw::Read4_1(uint8_t address, uint8_t cmd, uint8_t *status, bool *
 		*valid = false;
 	
 	uint32_t value=0;
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	int16_t data;
 	do{
 		flush();
 
+		begin_tx();
 		crc_clear();
 		write(address);
 		crc_update(address);
 		write(cmd);
 		crc_update(cmd);
+		end_tx();
 
 		data = read(timeout);
 		crc_update(data);
@@ -582,17 +692,19 @@ bool RoboClaw::ResetEncoders(uint8_t address){
 
 bool RoboClaw::ReadVersion(uint8_t address,char *version){
 	uint8_t data;
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	do{
 		flush();
 
 		data = 0;
 		
+		begin_tx();
 		crc_clear();
 		write(address);
 		crc_update(address);
 		write(GETVERSION);
 		crc_update(GETVERSION);
+		end_tx();
 	
 		uint8_t i;
 		for(i=0;i<48;i++){
@@ -685,6 +797,10 @@ bool RoboClaw::SpeedM1(uint8_t address, uint32_t speed){
 	return write_n(6,address,M1SPEED,SetDWORDval(speed));
 }
 
+uint8_t RoboClaw::EncodeSpeedM1(uint8_t *packet,uint8_t address,uint32_t speed){
+	return encode_n(packet,6,address,M1SPEED,SetDWORDval(speed));
+}
+
 bool RoboClaw::SpeedM2(uint8_t address, uint32_t speed){
 	return write_n(6,address,M2SPEED,SetDWORDval(speed));
 }
@@ -860,6 +976,10 @@ bool RoboClaw::SpeedAccelDeccelPositionM1(uint8_t address,uint32_t accel,uint32_
 	return write_n(19,address,M1SPEEDACCELDECCELPOS,SetDWORDval(accel),SetDWORDval(speed),SetDWORDval(deccel),SetDWORDval(position),flag);
 }
 
+uint8_t RoboClaw::EncodeSpeedAccelDeccelPositionM1(uint8_t *packet,uint8_t address,uint32_t accel,uint32_t speed,uint32_t deccel,uint32_t position,uint8_t flag){
+	return encode_n(packet,19,address,M1SPEEDACCELDECCELPOS,SetDWORDval(accel),SetDWORDval(speed),SetDWORDval(deccel),SetDWORDval(position),flag);
+}
+
 bool RoboClaw::SpeedAccelDeccelPositionM2(uint8_t address,uint32_t accel,uint32_t speed,uint32_t deccel,uint32_t position,uint8_t flag){
 	return write_n(19,address,M2SPEEDACCELDECCELPOS,SetDWORDval(accel),SetDWORDval(speed),SetDWORDval(deccel),SetDWORDval(position),flag);
 }
@@ -884,16 +1004,18 @@ bool RoboClaw::GetPinFunctions(uint8_t address, uint8_t &S3mode, uint8_t &S4mode
 	uint8_t crc;
 	bool valid = false;
 	uint8_t val1,val2,val3;
-	uint8_t trys=MAXRETRY;
+	uint8_t trys=retries;
 	int16_t data;
 	do{
 		flush();
 
+		begin_tx();
 		crc_clear();
 		write(address);
 		crc_update(address);
 		write(GETPINFUNCTIONS);
 		crc_update(GETPINFUNCTIONS);
+		end_tx();
 	
 		data = read(timeout);
 		crc_update(data);
@@ -25,6 +25,15 @@ class RoboClaw : public Stream
 {
 	uint16_t crc;
 	uint32_t timeout;
+	uint32_t ack_timeout;
+	uint8_t retries;
+
+	// Packets injected from interrupt context (see WritePacketFromISR)
+	volatile bool tx_busy;
+	volatile uint8_t urgent_acks;
+	const uint8_t * volatile urgent_packet;
+	volatile uint8_t urgent_len;
+	volatile uint32_t urgent_sent_us;
 	
 	HardwareSerial *hserial;
 #ifdef __AVR__
@@ -224,6 +233,26 @@ public:
 	bool SetPWMMode(uint8_t address, uint8_t mode);
 	bool GetPWMMode(uint8_t address, uint8_t &mode);
 	
+	// Pre-encoded packets, e.g. for sending from interrupt context without any math
+	static uint8_t EncodeSpeedAccelDeccelPositionM1(uint8_t *packet,uint8_t address,uint32_t accel,uint32_t speed,uint32_t deccel,uint32_t position,uint8_t flag);
+	static uint8_t EncodeSpeedM1(uint8_t *packet,uint8_t address,uint32_t speed);
+	// Send a pre-encoded packet and wait for its acknowledgement
+	bool WritePacket(const uint8_t *packet,uint8_t len);
+	// Send a pre-encoded packet from interrupt context. If a transaction is
+	// transmitting the packet is deferred until its last byte is queued. The
+	// acknowledgement is discarded at the start of the next transaction.
+	bool WritePacketFromISR(const uint8_t *packet,uint8_t len);
+	// Drop a deferred packet that was not sent yet, call with interrupts disabled
+	void CancelPacketFromISR(const uint8_t *packet);
+	// Time (us) the last packet from interrupt context was queued for transmission
+	uint32_t UrgentSentMicros() const { return urgent_sent_us; }
+	// Reply timeout (us) and retries of the following transactions, e.g. a single short
+	// try for a query that must not hold up the caller. Acks of packets sent from
+	// interrupt context keep the timeout given to the constructor.
+	void SetReadLimits(uint32_t tout,uint8_t trys) { timeout = tout; retries = trys; }
+	uint32_t GetTimeout() const { return timeout; }
+	uint8_t GetRetries() const { return retries; }
+
 	static int16_t library_version() { return _SS_VERSION; }
 
 	virtual int available();
@@ -242,6 +271,10 @@ private:
 	void crc_clear();
 	void crc_update (uint8_t data);
 	uint16_t crc_get();
+	static uint8_t encode_n(uint8_t *packet,uint8_t cnt,...);
+	void begin_tx();
+	void end_tx();
+	void send_urgent(const uint8_t *packet,uint8_t len);
 	bool write_n(uint8_t byte,...);
 	bool read_n(uint8_t byte,uint8_t address,uint8_t cmd,...);
 	uint32_t Read4_1(uint8_t address,uint8_t cmd,uint8_t *status,bool *valid);